@@ -40,6 +40,26 @@ extern "C" {
 	#define	gnuVG_BOLD_ITALIC          3 /* you can use gnuVG_ITALIC | gnuVG_BOLD */
 	typedef int gnuVGFontStyle;
 
+	/* gnuVG specific parameters for vgSeti()/vgGeti() */
+	typedef enum {
+		/* VG_TRUE keeps the stroke width in pixels, regardless
+		 * of the scale of the path user to surface matrix */
+		gnuVG_STROKE_NON_SCALING         = 0x1180,
+
+		/* VG_TRUE collects flat color fills and strokes and
+		 * renders them together, when the pipeline state changes
+		 * or on vgFlush()/vgFinish(). Call one of them before
+		 * swapping buffers or issuing your own GL calls. */
+		gnuVG_BATCH_FLAT_COLORS          = 0x1181,
+
+		/* Milliseconds the temporary framebuffers, and a mask
+		 * that was never drawn to or was cleared, may go unused
+		 * before they are released, checked at gnuvgUseContext(),
+		 * vgFlush() and vgFinish(). Negative values keep them
+		 * for the life of the context. */
+		gnuVG_IDLE_BUFFER_TIMEOUT        = 0x1182,
+	} gnuVGParamType;
+
 	typedef enum {
 		gnuVG_ANCHOR_START               = 0,
 		gnuVG_ANCHOR_MIDDLE              = 1,
@@ -52,6 +72,49 @@ extern "C" {
 		VGFont font, VGfloat size, gnuVGTextAnchor anchor,
 		const char* utf8, VGfloat x_anchor, VGfloat y_anchor);
 
+	/* Store linked shader programs in directory and load the
+	 * ones stored by earlier runs, avoiding compilation.
+	 * Requires GL_OES_get_program_binary, pass NULL to disable.
+	 */
+	VG_API_CALL void VG_API_ENTRY gnuvgSetShaderCacheDirectory(const char *directory) VG_API_EXIT;
+
+	/* Drawing features for gnuvgPrecompileShaders(). Blend modes
+	 * and the fill rule are not listed, they need no shaders. */
+	typedef enum {
+		gnuVG_SHADER_COLOR               = (1 << 0), /* color paint */
+		gnuVG_SHADER_LINEAR_GRADIENT     = (1 << 1),
+		gnuVG_SHADER_RADIAL_GRADIENT     = (1 << 2),
+		gnuVG_SHADER_PATTERN             = (1 << 3), /* pattern paint, vgDrawImage() */
+		gnuVG_SHADER_TEXT                = (1 << 4),
+		gnuVG_SHADER_GAUSSIAN_BLUR       = (1 << 5),
+		gnuVG_SHADER_STROKE              = (1 << 6),
+		gnuVG_SHADER_NON_SCALING_STROKE  = (1 << 7),
+		gnuVG_SHADER_DASHED_STROKE       = (1 << 8),
+		gnuVG_SHADER_ROUND_STROKE        = (1 << 9), /* round joins or caps */
+		gnuVG_SHADER_ANTIALIASING        = (1 << 10),
+		gnuVG_SHADER_MASK                = (1 << 11),
+		gnuVG_SHADER_COLOR_TRANSFORM     = (1 << 12),
+	} gnuVGShaderFeature;
+
+	/* Compile the shaders for every combination of these
+	 * gnuVGShaderFeature bits now, instead of when they are
+	 * first needed.
+	 */
+	VG_API_CALL void VG_API_ENTRY gnuvgPrecompileShaders(VGbitfield features) VG_API_EXIT;
+
+	/* Called on the shader compiler thread with VG_TRUE before
+	 * it compiles anything, and with VG_FALSE before it exits.
+	 * Bind or release a context sharing objects with yours.
+	 */
+	typedef void (*gnuVGBindContextCallback)(void *user_data, VGboolean bind);
+
+	/* Compile missing shaders on a background thread, drawing
+	 * with a slower generic shader until they are done. Pass
+	 * NULL to stop the thread and compile when needed again.
+	 */
+	VG_API_CALL void VG_API_ENTRY gnuvgSetShaderCompilerContext(
+		gnuVGBindContextCallback bind_context, void *user_data) VG_API_EXIT;
+
 	/* reset bounding box calculation */
 	VG_API_CALL void VG_API_ENTRY gnuvgResetBoundingBox();
 
@@ -0,0 +1,133 @@
+/*
+ * gnuVG - a free Vector Graphics library
+ * Copyright (C) 2016 by Anton Persson
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "gnuVG_colorramp.hh"
+#include "gnuVG_paint.hh"
+#include "gnuVG_glstate.hh"
+
+//#define __DO_GNUVG_DEBUG
+#include "gnuVG_debug.hh"
+
+#define ENABLE_GNUVG_PROFILER
+#include <VG/gnuVG_profiler.hh>
+
+namespace gnuVG {
+
+	ColorRampAtlas::~ColorRampAtlas() {
+		if(texture) {
+			if(auto state = GLState::get_current())
+				state->forget_texture(texture);
+			glDeleteTextures(1, &texture);
+		}
+	}
+
+	GLfloat ColorRampAtlas::get_row(const Paint *paint) {
+		auto version = paint->get_ramp_version();
+		int row = 0;
+		for(int k = 0; k < GNUVG_COLOR_RAMP_ROWS; k++) {
+			if(rows[k].ramp_version == version) {
+				row = k;
+				break;
+			}
+			if(rows[k].last_use < rows[row].last_use)
+				row = k;
+		}
+
+		if(rows[row].ramp_version != version) {
+			bake(paint, row);
+			rows[row].ramp_version = version;
+		}
+		rows[row].last_use = ++use_counter;
+
+		return ((GLfloat)row + 0.5f) / (GLfloat)GNUVG_COLOR_RAMP_ROWS;
+	}
+
+	/* Sample the ramp the way the stop loop in the shaders used to,
+	 * at the texel centres from offset 0.0 to 1.0.
+	 */
+	void ColorRampAtlas::bake(const Paint *paint, int row) {
+		ADD_GNUVG_PROFILER_PROBE(bake_color_ramp);
+
+		// without stops the ramp goes from opaque black to white
+		static const VGfloat default_offsets[] = { 0.0f, 1.0f };
+		static const VGfloat default_invfactor[] = { 1.0f, 1.0f };
+		static const VGfloat default_colors[] = {
+			0.0f, 0.0f, 0.0f, 1.0f,
+			1.0f, 1.0f, 1.0f, 1.0f
+		};
+
+		auto nr_stops = paint->get_nr_color_ramp_stops();
+		auto offsets = paint->get_color_ramp_stop_offsets();
+		auto invfactor = paint->get_color_ramp_stop_invfactors();
+		auto colors = paint->get_color_ramp_stop_colors();
+		if(nr_stops == 0) {
+			nr_stops = 2;
+			offsets = default_offsets;
+			invfactor = default_invfactor;
+			colors = default_colors;
+		}
+
+		GLubyte texels[GNUVG_COLOR_RAMP_WIDTH * 4];
+		for(int x = 0; x < GNUVG_COLOR_RAMP_WIDTH; x++) {
+			auto g = (VGfloat)x / (VGfloat)(GNUVG_COLOR_RAMP_WIDTH - 1);
+
+			VGfloat c[4];
+			for(int i = 0; i < 4; i++)
+				c[i] = colors[i];
+			for(int k = 0; k < nr_stops; k++) {
+				if(g >= offsets[k]) {
+					for(int i = 0; i < 4; i++)
+						c[i] = colors[k * 4 + i];
+				} else if(k > 0 && g >= offsets[k - 1]) {
+					auto f = (g - offsets[k - 1]) * invfactor[k - 1];
+					for(int i = 0; i < 4; i++)
+						c[i] = colors[(k - 1) * 4 + i] * (1.0f - f) +
+							colors[k * 4 + i] * f;
+				}
+			}
+
+			for(int i = 0; i < 4; i++) {
+				auto v = c[i] < 0.0f ? 0.0f : (c[i] > 1.0f ? 1.0f : c[i]);
+				texels[x * 4 + i] = (GLubyte)(v * 255.0f + 0.5f);
+			}
+		}
+
+		// unit 0 is never sampled from, we use it for updates
+		auto state = GLState::get_current();
+		if(!texture) {
+			glGenTextures(1, &texture);
+			state->bind_texture(0, texture);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
+				     GNUVG_COLOR_RAMP_WIDTH, GNUVG_COLOR_RAMP_ROWS, 0,
+				     GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+			checkGlError("ColorRampAtlas::bake() - glTexImage2D");
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		} else {
+			state->bind_texture(0, texture);
+		}
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, row,
+				GNUVG_COLOR_RAMP_WIDTH, 1,
+				GL_RGBA, GL_UNSIGNED_BYTE, texels);
+		checkGlError("ColorRampAtlas::bake() - glTexSubImage2D");
+	}
+
+};
@@ -0,0 +1,61 @@
+/*
+ * gnuVG - a free Vector Graphics library
+ * Copyright (C) 2016 by Anton Persson
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <VG/openvg.h>
+
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+
+#include "gnuVG_config.hh"
+
+namespace gnuVG {
+
+	class Paint;
+
+	/* The color ramps of gradient paints, baked into the rows of
+	 * one texture so a gradient costs a single texture lookup per
+	 * fragment. A ramp is baked again only when its stops change,
+	 * and the least recently used row is reused when all are taken.
+	 */
+	class ColorRampAtlas {
+	public:
+		~ColorRampAtlas();
+
+		// the texture coordinate of the row holding the ramp
+		// of paint, bakes the ramp if it is not in the atlas
+		GLfloat get_row(const Paint *paint);
+
+		GLuint get_texture() const { return texture; }
+
+	private:
+		GLuint texture = 0;
+
+		struct Row {
+			VGuint ramp_version = 0; // 0 when unused
+			VGuint last_use = 0;
+		};
+		Row rows[GNUVG_COLOR_RAMP_ROWS];
+		VGuint use_counter = 0;
+
+		void bake(const Paint *paint, int row);
+	};
+
+};
@@ -22,4 +22,41 @@
 
 #define GNUVG_MAX_COLOR_RAMP_STOPS 32
 
+// gradient color ramps are baked into a texture atlas of this
+// many texels per ramp, with room for this many ramps
+#define GNUVG_COLOR_RAMP_WIDTH 256
+#define GNUVG_COLOR_RAMP_ROWS 64
+
+// initial sizes, in bytes, of the streaming vertex and index buffers
+#define GNUVG_VERTEX_STREAM_SIZE (512 * 1024)
+#define GNUVG_INDEX_STREAM_SIZE (128 * 1024)
+
+// the number of vertices addressable by 16-bit indices
+#define GNUVG_MAX_INDEXED_VERTICES 65536
+
+// stroke vertices are centerline x, y, extrusion x, y, arc length,
+// the disc flag for round joins and caps and the outline side
+#define GNUVG_STROKE_VERTEX_SIZE 7
+
+// longer dash patterns are split into dashes on the CPU
+#define GNUVG_MAX_GPU_DASHES 16
+
+// strokes at most this wide, in pixels, are drawn as lines
+#define GNUVG_HAIRLINE_WIDTH 1.0f
+
+// the antialiasing fringe of fills is offset at most this many
+// times half a pixel at sharp corners
+#define GNUVG_FRINGE_MITER_LIMIT 4.0f
+
+// wider gaussian blur kernels, in taps, are applied to a
+// downsampled copy of the image to keep the cost bounded
+#define GNUVG_MAX_DIRECT_GAUSSIAN 33
+
+// the default of gnuVG_IDLE_BUFFER_TIMEOUT, in milliseconds
+#define GNUVG_DEFAULT_IDLE_BUFFER_TIMEOUT 5000
+
+// bump when the GLSL generated by Shader changes, so
+// cached program binaries from older builds are ignored
+#define GNUVG_SHADER_GENERATOR_VERSION 5
+
 #endif
@@ -24,6 +24,8 @@
 #include "gnuVG_context.hh"
 #include "gnuVG_config.hh"
 #include "gnuVG_image.hh"
+#include "gnuVG_programcache.hh"
+#include "gnuVG_shadercompiler.hh"
 
 //#define __DO_GNUVG_DEBUG
 #include "gnuVG_debug.hh"
@@ -41,7 +43,11 @@ namespace gnuVG {
 		, stroke_dash_phase_reset(false)
 		, miter_limit(4.0f)
 		, join_style(VG_JOIN_MITER)
+		, cap_style(VG_CAP_BUTT)
+		, idle_buffer_timeout(GNUVG_DEFAULT_IDLE_BUFFER_TIMEOUT)
 		, current_framebuffer(&screen_buffer)
+		, vertex_stream(GL_ARRAY_BUFFER, GNUVG_VERTEX_STREAM_SIZE)
+		, index_stream(GL_ELEMENT_ARRAY_BUFFER, GNUVG_INDEX_STREAM_SIZE)
 	{
 		default_fill_paint = Object::create<Paint>();
 		default_stroke_paint = Object::create<Paint>();
@@ -49,17 +55,34 @@ namespace gnuVG {
 		stroke_paint = default_stroke_paint;
 	}
 
-	Context::~Context() {}
+	Context::~Context() {
+		if(current_context == this) {
+			flush_batch();
+			current_context = nullptr;
+			GLState::set_current(nullptr);
+		}
+	}
 
 	Context *Context::get_current() {
 		return current_context;
 	}
 
 	void Context::set_current(Context *ctx) {
+		// the batch of the previous context goes out while
+		// its GL state is still the current one
+		if(current_context && current_context != ctx)
+			current_context->flush_batch();
 		current_context = ctx;
 
+		// the application may have touched GL in between
+		ctx->gl_state.invalidate();
+		GLState::set_current(&ctx->gl_state);
+
 		for(auto k = 0; k < GNUVG_MATRIX_MAX; k++)
 			ctx->matrix_is_dirty[k] = true;
+
+		// gnuvgUseContext() is called for each frame
+		ctx->release_idle_buffers();
 	}
 
 	void Context::set_error(VGErrorCode new_error) {
@@ -94,9 +117,19 @@ namespace gnuVG {
 	}
 
 	VGJoinStyle Context::get_join_style() {
+		if(rendering_quality != VG_RENDERING_QUALITY_BETTER)
+			return VG_JOIN_BEVEL;
 		return join_style;
 	}
 
+	VGRenderingQuality Context::get_rendering_quality() {
+		return rendering_quality;
+	}
+
+	VGCapStyle Context::get_cap_style() {
+		return cap_style;
+	}
+
 	std::vector<VGfloat> Context::get_dash_pattern() {
 		return dash_pattern;
 	}
@@ -109,10 +142,67 @@ namespace gnuVG {
 		return stroke_dash_phase_reset;
 	}
 
+	bool Context::dash_on_gpu() {
+		// every dash needs its own caps
+		if(cap_style != VG_CAP_BUTT) return false;
+
+		// an uneven pattern is repeated twice in the shader
+		auto nr_dashes = dash_pattern.size();
+		if(nr_dashes & 1) nr_dashes *= 2;
+		return nr_dashes > 0 && nr_dashes <= GNUVG_MAX_GPU_DASHES;
+	}
+
+	bool Context::antialiasing_enabled() {
+		return rendering_quality == VG_RENDERING_QUALITY_BETTER;
+	}
+
+	void Context::use_texture_filter(const FrameBuffer *fb) {
+		use_texture_filter(fb,
+				   (fb->allow_linear_filter &&
+				    rendering_quality == VG_RENDERING_QUALITY_BETTER) ?
+				   GL_LINEAR : GL_NEAREST);
+	}
+
+	void Context::use_texture_filter(const FrameBuffer *fb, GLint filter) {
+		if(fb->filter != filter) {
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+			fb->filter = filter;
+		}
+	}
+
+	void Context::use_texture_wrap(const FrameBuffer *fb, GLint wrap_mode) {
+		if(fb->wrap != wrap_mode) {
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap_mode);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap_mode);
+			fb->wrap = wrap_mode;
+		}
+	}
+
+	bool Context::stroke_is_hairline() {
+		if(stroke_width <= 0.0f) return false;
+		if(dash_pattern.size() > 0 && !dash_on_gpu()) return false;
+
+		auto device_width = stroke_width;
+		if(!non_scaling_stroke) {
+			auto origo = map_point(Point(0.0f, 0.0f));
+			auto x_scale = (map_point(Point(1.0f, 0.0f)) - origo).length();
+			auto y_scale = (map_point(Point(0.0f, 1.0f)) - origo).length();
+			device_width *= x_scale > y_scale ? x_scale : y_scale;
+		}
+		return device_width <= GNUVG_HAIRLINE_WIDTH;
+	}
+
 	void Context::vgFlush() {
+		flush_batch();
+		release_idle_buffers();
+		glFlush();
 	}
 
 	void Context::vgFinish() {
+		flush_batch();
+		release_idle_buffers();
+		glFinish();
 	}
 
 	/* OpenVG equivalent API - Paint Manipulation */
@@ -172,6 +262,7 @@ namespace gnuVG {
 		matrix[user_matrix].g = m[6];
 		matrix[user_matrix].h = m[7];
 		matrix[user_matrix].i = m[8];
+		force_affine_user_matrix();
 
 		matrix_is_dirty[user_matrix] = true;
 	}
@@ -198,9 +289,20 @@ namespace gnuVG {
 		Matrix result; result.multiply(matrix[user_matrix], b);
 
 		matrix[user_matrix].set_to(result);
+		force_affine_user_matrix();
 		matrix_is_dirty[user_matrix] = true;
 	}
 
+	void Context::force_affine_user_matrix() {
+		// only the image matrix may be projective, the bottom row
+		// of the others is ignored and reads back as (0, 0, 1)
+		if(user_matrix == GNUVG_MATRIX_IMAGE_USER_TO_SURFACE)
+			return;
+		matrix[user_matrix].c = 0.0f;
+		matrix[user_matrix].f = 0.0f;
+		matrix[user_matrix].i = 1.0f;
+	}
+
 	void Context::vgTranslate(VGfloat tx, VGfloat ty) {
 		matrix[user_matrix].translate(tx, ty);
 		matrix_is_dirty[user_matrix] = true;
@@ -339,9 +441,21 @@ namespace gnuVG {
 			}
 			break;
 
+		case VG_RENDERING_QUALITY:
+			switch((VGRenderingQuality)value) {
+			case VG_RENDERING_QUALITY_NONANTIALIASED:
+			case VG_RENDERING_QUALITY_FASTER:
+			case VG_RENDERING_QUALITY_BETTER:
+				rendering_quality = (VGRenderingQuality)value;
+				break;
+			default:
+				set_error(VG_ILLEGAL_ARGUMENT_ERROR);
+				break;
+			}
+			break;
+
 		case VG_FILL_RULE:
 		case VG_IMAGE_QUALITY:
-		case VG_RENDERING_QUALITY:
 		case VG_IMAGE_MODE:
 			break;
 
@@ -391,6 +505,31 @@ namespace gnuVG {
 
 			/* Stroke parameters */
 		case VG_STROKE_CAP_STYLE:
+			switch((VGCapStyle)value) {
+			case VG_CAP_BUTT:
+				cap_style = VG_CAP_BUTT;
+				break;
+			case VG_CAP_ROUND:
+				cap_style = VG_CAP_ROUND;
+				break;
+			case VG_CAP_SQUARE:
+				cap_style = VG_CAP_SQUARE;
+				break;
+			default:
+				set_error(VG_ILLEGAL_ARGUMENT_ERROR);
+				break;
+			}
+			break;
+		case gnuVG_STROKE_NON_SCALING:
+			non_scaling_stroke = (((VGboolean)value) == VG_TRUE) ? true : false;
+			break;
+		case gnuVG_BATCH_FLAT_COLORS:
+			batch_flat_colors = (((VGboolean)value) == VG_TRUE) ? true : false;
+			if(!batch_flat_colors)
+				flush_batch();
+			break;
+		case gnuVG_IDLE_BUFFER_TIMEOUT:
+			idle_buffer_timeout = value;
 			break;
 		case VG_STROKE_JOIN_STYLE:
 			switch((VGJoinStyle)value) {
@@ -424,6 +563,8 @@ namespace gnuVG {
 			/* Enable/disable alpha masking and scissoring */
 		case VG_MASKING:
 			mask_is_active = (((VGboolean)value) == VG_TRUE) ? true : false;
+			if(mask_is_active)
+				use_internal_buffer(&mask);
 			break;
 
 		case VG_SCISSORING:
@@ -479,6 +620,7 @@ namespace gnuVG {
 
 			break;
 		case VG_COLOR_TRANSFORM_VALUES:
+			flush_batch();
 			if(count == 8)
 				for(int k = 0; k < 4; ++k) {
 					color_transform_scale[k] = values[k];
@@ -640,9 +782,11 @@ namespace gnuVG {
 			return user_matrix;
 		}
 
+		case VG_RENDERING_QUALITY:
+			return rendering_quality;
+
 		case VG_FILL_RULE:
 		case VG_IMAGE_QUALITY:
-		case VG_RENDERING_QUALITY:
 		case VG_IMAGE_MODE:
 			break;
 
@@ -682,9 +826,15 @@ namespace gnuVG {
 
 			/* Stroke parameters */
 		case VG_STROKE_CAP_STYLE:
-			break;
+			return cap_style;
 		case VG_STROKE_JOIN_STYLE:
 			return join_style;
+		case gnuVG_STROKE_NON_SCALING:
+			return non_scaling_stroke ? VG_TRUE : VG_FALSE;
+		case gnuVG_BATCH_FLAT_COLORS:
+			return batch_flat_colors ? VG_TRUE : VG_FALSE;
+		case gnuVG_IDLE_BUFFER_TIMEOUT:
+			return idle_buffer_timeout;
 		case VG_STROKE_DASH_PHASE_RESET:
 			return stroke_dash_phase_reset ? VG_TRUE : VG_FALSE;
 
@@ -825,59 +975,103 @@ namespace gnuVG {
 /* Backend implementation specific functions - OpenGL */
 namespace gnuVG {
 
+	static inline GLsizeiptr vertex_array_size(GLint stride, GLsizei nr_vertices) {
+		return nr_vertices * (stride ? stride : 2) * sizeof(GLfloat);
+	}
+
+	template <typename T>
+	static inline const T* stream_offset(GLintptr offset) {
+		return reinterpret_cast<const T*>(offset);
+	}
+
 	void Context::render_scissors() {
+		flush_batch();
+
 		if(scissors_are_active &&  nr_active_scissors > 0) {
-			glEnable(GL_STENCIL_TEST);
-			glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+			// the stencil of a texture is attached when needed
+			if(current_framebuffer->texture != 0 &&
+			   current_framebuffer->stencil == 0)
+				attach_stencil(current_framebuffer);
+
+			gl_state.set_stencil_test(true);
+			gl_state.color_mask(false);
 
 			// first we clear the stencil to zero
-			glStencilMask(0xff);
+			gl_state.stencil_mask(0xff);
 			glClearStencil(0);
 			glClear(GL_STENCIL_BUFFER_BIT);
 
 			// then we render the scissor elements
-			glStencilFunc(GL_ALWAYS,
-				      1,
-				      1);
-			glStencilOp(GL_REPLACE, GL_REPLACE, GL_REPLACE);
+			gl_state.stencil_func(GL_ALWAYS,
+					      1,
+					      1);
+			gl_state.stencil_op(GL_REPLACE, GL_REPLACE, GL_REPLACE);
 
 			trivial_render_elements(scissor_vertices,
+						4 * nr_active_scissors,
 						scissor_triangles,
 						6 * nr_active_scissors,
 						// colors will be ignored
 						// because of disabled color mask
 						1.0, 0.0, 0.0, 0.5);
 
-			glStencilFunc(GL_EQUAL, 1, 1);
-			glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
-			glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-			glStencilMask(0x0);
+			gl_state.stencil_func(GL_EQUAL, 1, 1);
+			gl_state.stencil_op(GL_KEEP, GL_KEEP, GL_KEEP);
+			gl_state.color_mask(true);
+			gl_state.stencil_mask(0x0);
 		} else
-			glDisable(GL_STENCIL_TEST);
+			gl_state.set_stencil_test(false);
 	}
 
-	void Context::recreate_buffers() {
-		// Then the mask
-		if(mask.framebuffer != 0)
-			delete_framebuffer(&mask);
-		if(!create_framebuffer(&mask, VG_sRGBA_8888,
-				       current_framebuffer->width, current_framebuffer->height,
-				       VG_IMAGE_QUALITY_FASTER))
-			GNUVG_ERROR("failed to create framebuffer for mask.\n");
+	auto Context::use_internal_buffer(FrameBuffer* fb) -> FrameBuffer* {
+		fb->last_use = std::chrono::steady_clock::now();
+
+		if(fb->texture != 0 &&
+		   fb->width == screen_buffer.width &&
+		   fb->height == screen_buffer.height)
+			return fb;
 
-		// Then two temporary buffers
-		if(temporary_a.framebuffer != 0)
+		if(fb->texture != 0)
+			delete_framebuffer(fb);
+		if(!create_coverage_framebuffer(fb,
+						screen_buffer.width, screen_buffer.height,
+						VG_IMAGE_QUALITY_FASTER))
+			GNUVG_ERROR("failed to create internal framebuffer.\n");
+		return fb;
+	}
+
+	void Context::release_idle_buffers() {
+		if(idle_buffer_timeout < 0)
+			return; // kept for the life of the context
+
+		auto now = std::chrono::steady_clock::now();
+		auto timeout = std::chrono::milliseconds(idle_buffer_timeout);
+		auto is_idle = [now, timeout](const FrameBuffer* fb) {
+			return now - fb->last_use >= timeout;
+		};
+
+		// the mask outlives VG_MASKING, so it and the temporaries
+		// it is swapped with are only released while they are
+		// empty, recreating them would lose their content
+		auto is_unused = [&is_idle](const FrameBuffer* fb) {
+			return fb->texture != 0 && !fb->holds_data && is_idle(fb);
+		};
+		if(!mask_is_active && is_unused(&mask))
+			delete_framebuffer(&mask);
+		if(is_unused(&temporary_a))
 			delete_framebuffer(&temporary_a);
-		if(!create_framebuffer(&temporary_a, VG_sRGBA_8888,
-				       current_framebuffer->width, current_framebuffer->height,
-				       VG_IMAGE_QUALITY_FASTER))
-			GNUVG_ERROR("failed to create framebuffer for temporary_a.\n");
-		if(temporary_b.framebuffer != 0)
+		if(is_unused(&temporary_b))
 			delete_framebuffer(&temporary_b);
-		if(!create_framebuffer(&temporary_b, VG_sRGBA_8888,
-				       current_framebuffer->width, current_framebuffer->height,
-				       VG_IMAGE_QUALITY_FASTER))
-			GNUVG_ERROR("failed to create framebuffer for temporary_b.\n");
+
+		auto &pool = available_temporary_framebuffers;
+		for(auto k = pool.begin(); k != pool.end();) {
+			if(is_idle(*k)) {
+				delete_framebuffer(*k);
+				delete (*k);
+				k = pool.erase(k);
+			} else
+				k++;
+		}
 	}
 
 	void Context::resize(VGint pxlw, VGint pxlh) {
@@ -909,6 +1103,8 @@ namespace gnuVG {
 						 int gaussian_width,
 						 int gaussian_height,
 						 VGTilingMode tiling_mode) {
+		flush_batch();
+
 		VGfloat w, h;
 
 		if(framebuffer->subset_width >= 0) {
@@ -966,7 +1162,7 @@ namespace gnuVG {
 			c4.x, c4.y,
 		};
 
-		GLuint indices[] = {
+		GLushort indices[] = {
 			0, 1, 2,
 			0, 2, 3
 		};
@@ -989,72 +1185,125 @@ namespace gnuVG {
 
 		prepare_framebuffer_matrix(framebuffer);
 
-		auto f = [this, vertices, vertices_full, mat, mat_full, indices, wrap_mode]
+		// the blur kernel and the resampling between
+		// pyramid levels both depend on linear filtering
+		bool blurring = gaussian_width > 1 || gaussian_height > 1;
+
+		// intermediate passes cover the whole current framebuffer,
+		// the final one renders the image into the current target
+		auto f = [this, vertices, vertices_full, mat, mat_full, indices, wrap_mode, blurring]
 			(const FrameBuffer *fbuffer,
-			 bool do_horizontal_gauss,
-			 int kern_diameter) {
+			 bool intermediate,
+			 int kern_diameter,
+			 bool horizontal) {
 			int caps = Shader::do_pattern;
-			if(kern_diameter > 1) {
-				caps |= do_horizontal_gauss ?
-					Shader::do_horizontal_gaussian :
-					Shader::do_vertical_gaussian;
-				caps |= (kern_diameter << Shader::gauss_krn_diameter_shift) &
-					Shader::gauss_krn_diameter_mask;
-			}
-			if(do_color_transform)
+			if(kern_diameter > 1)
+				caps |= Shader::gaussian_caps(kern_diameter);
+			if(do_color_transform && !intermediate)
 				caps |= Shader::do_color_transform;
 
-			active_shader = Shader::get_shader(
-				caps
-				);
-			active_shader->use_shader();
-			active_shader->set_blending(blend_mode);
+			active_shader = Shader::get_shader(caps);
+			active_shader->use_shader(caps);
+			active_shader->set_blending(intermediate ? Shader::blend_src : blend_mode);
 			active_shader->set_matrix(mat);
 
-			if(do_color_transform)
+			if(do_color_transform && !intermediate)
 				active_shader->set_color_transform(
 					color_transform_scale,
 					color_transform_bias);
 
 			active_shader->set_pattern_texture(fbuffer->texture);
-			active_shader->set_wrap_mode(wrap_mode);
-			active_shader->set_pattern_matrix(do_horizontal_gauss ?
+			if(blurring)
+				use_texture_filter(fbuffer, GL_LINEAR);
+			else
+				use_texture_filter(fbuffer);
+			use_texture_wrap(fbuffer, wrap_mode);
+			active_shader->set_pattern_matrix(intermediate ?
 							  mat_full :
 							  image_matrix_data);
-			active_shader->set_pattern_size(fbuffer->width, fbuffer->height);
+			if(kern_diameter > 1) {
+				if(horizontal)
+					active_shader->set_gaussian_kernel(
+						kern_diameter, 1.0f / fbuffer->width, 0.0f);
+				else
+					active_shader->set_gaussian_kernel(
+						kern_diameter, 0.0f, 1.0f / fbuffer->height);
+			}
 
-			active_shader->load_2dvertex_array(do_horizontal_gauss ?
-							   vertices_full : vertices,
-							   0);
-			active_shader->render_elements(indices, 6);
+			load_2dvertex_array(intermediate ?
+					    vertices_full : vertices,
+					    0, 4);
+			render_elements(indices, 6);
 		};
-		if(gaussian_width <= 1 && gaussian_height <= 1)
-			f(framebuffer, false, 1);
-		else {
-			auto tfbf = get_temporary_framebuffer(VG_sRGBA_8888,
-							      framebuffer->width, framebuffer->height,
-							      VG_IMAGE_QUALITY_BETTER);
-
-			if(tfbf) {
-				save_current_framebuffer();
-				render_to_framebuffer(tfbf);
-				auto keep_old_blend_mode = blend_mode;
-				blend_mode = Shader::blend_src;
-				trivial_fill_area(0, 0,
-						  tfbf->width, tfbf->height,
-						  0.0, 0.0, 0.0, 0.0);
-				blend_mode = keep_old_blend_mode;
-				f(framebuffer, true, gaussian_width);
-				restore_current_framebuffer();
-				f(tfbf, false, gaussian_height);
-				return_temporary_framebuffer(tfbf);
+		if(!blurring) {
+			f(framebuffer, false, 1, false);
+			return;
+		}
+
+		save_current_framebuffer();
+
+		// render source into a new temporary framebuffer, which
+		// then becomes the source for the next pass
+		const FrameBuffer *source = framebuffer;
+		FrameBuffer *level = nullptr;
+		auto next_pass = [this, &f, &source, &level]
+			(VGint w, VGint h, int kern_diameter, bool horizontal) {
+			auto target = get_temporary_framebuffer(VG_sRGBA_8888,
+								w, h,
+								VG_IMAGE_QUALITY_BETTER);
+			if(!target)
+				return false;
+			render_to_framebuffer(target);
+			f(source, true, kern_diameter, horizontal);
+			if(level)
+				return_temporary_framebuffer(level);
+			source = level = target;
+			return true;
+		};
+
+		// Large kernels are applied to a downsampled copy, halving
+		// the resolution and the kernel until it is short enough,
+		// so the cost stays about the same for any deviation.
+		auto level_w = framebuffer->width;
+		auto level_h = framebuffer->height;
+		bool ok = true;
+		while(ok &&
+		      ((gaussian_width > GNUVG_MAX_DIRECT_GAUSSIAN && level_w > 1) ||
+		       (gaussian_height > GNUVG_MAX_DIRECT_GAUSSIAN && level_h > 1))) {
+			if(gaussian_width > GNUVG_MAX_DIRECT_GAUSSIAN && level_w > 1) {
+				level_w = (level_w + 1) / 2;
+				gaussian_width = (gaussian_width - 1) / 2 + 1;
 			}
+			if(gaussian_height > GNUVG_MAX_DIRECT_GAUSSIAN && level_h > 1) {
+				level_h = (level_h + 1) / 2;
+				gaussian_height = (gaussian_height - 1) / 2 + 1;
+			}
+			ok = next_pass(level_w, level_h, 1, false);
 		}
+		bool downsampled = level != nullptr;
+
+		if(ok && gaussian_width > 1)
+			ok = next_pass(level_w, level_h, gaussian_width, true);
+
+		// a downsampled image is blurred before it is scaled
+		// back up, otherwise the last pass does it directly
+		if(ok && gaussian_height > 1 && downsampled) {
+			ok = next_pass(level_w, level_h, gaussian_height, false);
+			gaussian_height = 1;
+		}
+
+		restore_current_framebuffer();
+		if(ok)
+			f(source, false, gaussian_height, false);
+		if(level)
+			return_temporary_framebuffer(level);
 	}
 
 	void Context::trivial_render_elements(
-		GLfloat *vertices, GLuint *indices, GLsizei indices_count,
+		GLfloat *vertices, GLsizei nr_vertices,
+		GLushort *indices, GLsizei indices_count,
 		VGfloat r, VGfloat g, VGfloat b, VGfloat a) {
+		flush_batch();
 
 		Matrix *m = &screen_matrix;
 		GLfloat mat[] = {
@@ -1066,11 +1315,10 @@ namespace gnuVG {
 
 		VGfloat col[] = {r, g, b, a};
 
-		active_shader = Shader::get_shader(
-			Shader::do_flat_color |
-			(do_color_transform ? Shader::do_color_transform : 0)
-			);
-		active_shader->use_shader();
+		auto caps = Shader::do_flat_color |
+			(do_color_transform ? Shader::do_color_transform : 0);
+		active_shader = Shader::get_shader(caps);
+		active_shader->use_shader(caps);
 		active_shader->set_blending(blend_mode);
 		active_shader->set_matrix(mat);
 		active_shader->set_color(col);
@@ -1078,34 +1326,39 @@ namespace gnuVG {
 			active_shader->set_color_transform(
 				color_transform_scale,
 				color_transform_bias);
-		active_shader->load_2dvertex_array(vertices, 0);
-		active_shader->render_elements(indices, indices_count);
+		load_2dvertex_array(vertices, 0, nr_vertices);
+		render_elements(indices, indices_count);
 	}
 
 	void Context::render_texture_alpha_triangle_array(const FrameBuffer *fb,
 							  const GLfloat *ver_c_2d, GLint ver_stride_2d,
 							  const GLfloat *tex_c_2d, GLint tex_stride_2d,
-							  const GLuint *indices, GLsizei nr_indices,
+							  GLsizei nr_vertices,
+							  const GLushort *indices, GLsizei nr_indices,
 							  const GLfloat *texture_matrix_3by3) {
+		flush_batch();
 
-		active_shader = Shader::get_shader(
-			Shader::do_flat_color |
+		auto caps = Shader::do_flat_color |
 			(do_color_transform ? Shader::do_color_transform : 0)
-			| Shader::do_texture_alpha
-			);
-		active_shader->use_shader();
+			| Shader::do_texture_alpha;
+		active_shader = Shader::get_shader(caps);
+		active_shader->use_shader(caps);
 		active_shader->set_blending(blend_mode);
-		active_shader->set_matrix(conversion_matrix_data);
+		active_shader->set_matrix(conversion_matrix_data, conversion_matrix_version);
 		if(do_color_transform)
 			active_shader->set_color_transform(
 				color_transform_scale,
 				color_transform_bias);
-		active_shader->load_2dvertex_array(ver_c_2d, ver_stride_2d);
-		active_shader->load_2dvertex_texture_array(tex_c_2d, tex_stride_2d);
+		// an orphan between the two arrays would lose the first
+		vertex_stream.reserve(vertex_array_size(ver_stride_2d, nr_vertices) +
+				      vertex_array_size(tex_stride_2d, nr_vertices));
+		load_2dvertex_array(ver_c_2d, ver_stride_2d, nr_vertices);
+		load_2dvertex_texture_array(tex_c_2d, tex_stride_2d, nr_vertices);
 		active_shader->set_texture(fb->texture);
+		use_texture_filter(fb);
 		active_shader->set_texture_matrix(texture_matrix_3by3);
-		active_shader->set_color(fill_paint->color.c);
-		active_shader->render_elements(indices, nr_indices);
+		active_shader->set_color(fill_paint->get_color().c, fill_paint->get_version());
+		render_elements(indices, nr_indices);
 	}
 
 	void Context::trivial_fill_area(
@@ -1124,12 +1377,12 @@ namespace gnuVG {
 			x        , y + height
 		};
 
-		GLuint indices[] = {
+		GLushort indices[] = {
 			0, 1, 2,
 			0, 2, 3
 		};
 
-		trivial_render_elements(vertices, indices, 6, r, g, b, a);
+		trivial_render_elements(vertices, 4, indices, 6, r, g, b, a);
 	}
 
 	void Context::prepare_framebuffer_matrix(const FrameBuffer* fbuf) {
@@ -1165,38 +1418,18 @@ namespace gnuVG {
 
 	void Context::select_conversion_matrix(MatrixMode _conversion_matrix) {
 		if(conversion_matrix != _conversion_matrix ||
-		   matrix_is_dirty[_conversion_matrix] ||
-		   matrix_is_dirty[GNUVG_MATRIX_FILL_PAINT_TO_USER] ||
-		   matrix_is_dirty[GNUVG_MATRIX_STROKE_PAINT_TO_USER]) {
-
+		   matrix_is_dirty[_conversion_matrix]) {
 			matrix_is_dirty[_conversion_matrix] = false;
-			matrix_is_dirty[GNUVG_MATRIX_FILL_PAINT_TO_USER] = false;
-			matrix_is_dirty[GNUVG_MATRIX_STROKE_PAINT_TO_USER] = false;
 
 			/* calculate regualar conversion matrix */
 			final_matrix[_conversion_matrix].multiply(
 				screen_matrix,
 				matrix[_conversion_matrix]);
 
-			/* then also the surface -> paint matrices */
-			final_matrix[GNUVG_MATRIX_FILL_PAINT_TO_USER].multiply(
-				final_matrix[_conversion_matrix],
-				matrix[GNUVG_MATRIX_FILL_PAINT_TO_USER]
-				);
-			final_matrix[GNUVG_MATRIX_FILL_PAINT_TO_USER].invert();
-
-			final_matrix[GNUVG_MATRIX_STROKE_PAINT_TO_USER].multiply(
-				final_matrix[_conversion_matrix],
-				matrix[GNUVG_MATRIX_STROKE_PAINT_TO_USER]
-				);
-			final_matrix[GNUVG_MATRIX_STROKE_PAINT_TO_USER].invert();
-		}
-
-		conversion_matrix = _conversion_matrix;
-
-		/* convert user2surface conversion matrix to GL friendly format */
-		{
-			Matrix *m = &final_matrix[conversion_matrix];
+			/* convert user2surface conversion matrix to GL friendly format,
+			 * path and glyph matrices are always affine
+			 */
+			Matrix *m = &final_matrix[_conversion_matrix];
 			GLfloat mat[] = {
 				m->a, m->b, 0.0f, 0.0f,
 				m->d, m->e, 0.0f, 0.0f,
@@ -1204,31 +1437,56 @@ namespace gnuVG {
 				m->g, m->h, 0.0f, 1.0f
 			};
 			memcpy(conversion_matrix_data, mat, sizeof(mat));
+			conversion_matrix_version = Object::new_version();
+
+			// the surface -> paint matrices depend on this one
+			matrix_is_dirty[GNUVG_MATRIX_FILL_PAINT_TO_USER] = true;
+			matrix_is_dirty[GNUVG_MATRIX_STROKE_PAINT_TO_USER] = true;
 		}
-		/* convert surface2fill conversion matrix to GL friendly format */
-		{
-			Matrix *m = &final_matrix[GNUVG_MATRIX_FILL_PAINT_TO_USER];
-			GLfloat mat[] = {
-				m->a, m->b, 0.0f, 0.0f,
-				m->d, m->e, 0.0f, 0.0f,
-				0.0f, 0.0f, 1.0f, 0.0f,
-				m->g, m->h, 0.0f, 1.0f
-			};
-			memcpy(surf2fill_matrix_data, mat, sizeof(mat));
-		}
-		/* convert surface2stroke conversion matrix to GL friendly format */
-		{
-			Matrix *m = &final_matrix[GNUVG_MATRIX_STROKE_PAINT_TO_USER];
-			GLfloat mat[] = {
-				m->a, m->b, 0.0f, 0.0f,
-				m->d, m->e, 0.0f, 0.0f,
-				0.0f, 0.0f, 1.0f, 0.0f,
-				m->g, m->h, 0.0f, 1.0f
-			};
+
+		conversion_matrix = _conversion_matrix;
+	}
+
+	void Context::prepare_surf2paint_matrix(VGPaintMode mode) {
+		auto k = mode == VG_STROKE_PATH ?
+			GNUVG_MATRIX_STROKE_PAINT_TO_USER :
+			GNUVG_MATRIX_FILL_PAINT_TO_USER;
+		if(!matrix_is_dirty[k])
+			return;
+		matrix_is_dirty[k] = false;
+
+		final_matrix[k].multiply(final_matrix[conversion_matrix], matrix[k]);
+		final_matrix[k].invert();
+
+		/* convert surface2paint conversion matrix to GL friendly format,
+		 * it is affine since the paint and conversion matrices are
+		 */
+		Matrix *m = &final_matrix[k];
+		GLfloat mat[] = {
+			m->a, m->b, 0.0f, 0.0f,
+			m->d, m->e, 0.0f, 0.0f,
+			0.0f, 0.0f, 1.0f, 0.0f,
+			m->g, m->h, 0.0f, 1.0f
+		};
+		if(mode == VG_STROKE_PATH) {
 			memcpy(surf2stroke_matrix_data, mat, sizeof(mat));
+			surf2stroke_matrix_version = Object::new_version();
+		} else {
+			memcpy(surf2fill_matrix_data, mat, sizeof(mat));
+			surf2fill_matrix_version = Object::new_version();
 		}
 	}
 
+	void Context::use_surf2paint_matrix() {
+		prepare_surf2paint_matrix(pipeline_mode);
+		if(pipeline_mode == VG_STROKE_PATH)
+			active_shader->set_surf2paint_matrix(surf2stroke_matrix_data,
+							     surf2stroke_matrix_version);
+		else
+			active_shader->set_surf2paint_matrix(surf2fill_matrix_data,
+							     surf2fill_matrix_version);
+	}
+
 	void Context::use_pipeline(gnuVGPipeline new_pipeline, VGPaintMode _mode) {
 		ADD_GNUVG_PROFILER_PROBE(use_pipeline);
 		pipeline_mode = _mode;
@@ -1239,7 +1497,7 @@ namespace gnuVG {
 		int caps = Shader::do_flat_color | Shader::do_pretranslate;
 
 		bool gradient_enabled = false;
-		switch(active_paint->ptype) {
+		switch(active_paint->get_paint_type()) {
 		case VG_PAINT_TYPE_COLOR:
 		case VG_PAINT_TYPE_FORCE_SIZE:
 			break;
@@ -1262,7 +1520,7 @@ namespace gnuVG {
 		if(mask_is_active) caps |= Shader::do_mask;
 
 		if(gradient_enabled)
-			switch(active_paint->spread_mode) {
+			switch(active_paint->get_spread_mode()) {
 			case VG_COLOR_RAMP_SPREAD_MODE_FORCE_SIZE:
 				break;
 			case VG_COLOR_RAMP_SPREAD_PAD:
@@ -1276,58 +1534,111 @@ namespace gnuVG {
 				break;
 			}
 
+		if(gradient_enabled && active_paint->is_two_stop_ramp())
+			caps |= Shader::do_two_stop_ramp;
+
 		if(do_color_transform)
 			caps |= Shader::do_color_transform;
 
+		if(antialiasing_enabled())
+			caps |= Shader::do_coverage;
+
+		if(pipeline_mode == VG_STROKE_PATH) {
+			caps |= Shader::do_stroke_extrusion;
+			if(non_scaling_stroke)
+				caps |= Shader::do_nonscaling_stroke;
+			if(dash_on_gpu())
+				caps |= Shader::do_dash;
+			if(get_join_style() == VG_JOIN_ROUND || cap_style == VG_CAP_ROUND)
+				caps |= Shader::do_disc;
+		}
+
+		// antialiased strokes compute their coverage per fragment
+		bool stroke_coverage =
+			(caps & Shader::do_coverage) && (caps & Shader::do_stroke_extrusion);
+
+		if(batch_flat_colors &&
+		   active_paint->get_paint_type() == VG_PAINT_TYPE_COLOR && !stroke_coverage &&
+		   !(caps & (Shader::do_dash | Shader::do_disc))) {
+			/* Flat colors are collected into the batch, which
+			 * is rendered first when the pipeline state changes.
+			 * Batched vertices are transformed and extruded
+			 * on the CPU, and fill coverage goes into the alpha.
+			 */
+			auto bcaps = (caps & ~(Shader::do_pretranslate |
+					       Shader::do_stroke_extrusion |
+					       Shader::do_nonscaling_stroke |
+					       Shader::do_coverage))
+				| Shader::do_vertex_color;
+			if(bcaps != batch_caps || blend_mode != batch_blend_mode)
+				render_batch();
+			batch_caps = bcaps;
+			batch_blend_mode = blend_mode;
+			memcpy(batch_color, active_paint->get_color().c, sizeof(batch_color));
+			batching = true;
+			return;
+		}
+		flush_batch();
+
 		active_shader = Shader::get_shader(caps);
-		active_shader->use_shader();
+		active_shader->use_shader(caps);
 		active_shader->set_blending(blend_mode);
-		active_shader->set_matrix(conversion_matrix_data);
+		active_shader->set_matrix(conversion_matrix_data, conversion_matrix_version);
 		active_shader->set_pre_translation(pre_translation);
 
+		if(caps & Shader::do_stroke_extrusion)
+			active_shader->set_stroke_width(stroke_width);
+		if(caps & Shader::do_nonscaling_stroke)
+			active_shader->set_viewport_size(buffer_width, buffer_height);
+		if(stroke_coverage) {
+			auto half_width = 0.5f * stroke_width;
+			if(!non_scaling_stroke) {
+				auto origo = map_point(Point(0.0f, 0.0f));
+				auto x_axis = map_point(Point(1.0f, 0.0f)) - origo;
+				auto y_axis = map_point(Point(0.0f, 1.0f)) - origo;
+				half_width *= sqrtf(fabsf(x_axis.cross(y_axis)));
+			}
+			// the shader divides by the half width
+			if(half_width < 1.0f / 64.0f)
+				half_width = 1.0f / 64.0f;
+			active_shader->set_stroke_half_width(half_width);
+		}
+		if(caps & Shader::do_dash) {
+			// the shader wants where each dash ends
+			GLfloat dash_ends[GNUVG_MAX_GPU_DASHES];
+			GLfloat dash_end = 0.0f;
+			auto nr_dashes = dash_pattern.size();
+			if(nr_dashes & 1) nr_dashes *= 2;
+			for(size_t k = 0; k < nr_dashes; k++) {
+				dash_end += fmaxf(0.0f, dash_pattern[k % dash_pattern.size()]);
+				dash_ends[k] = dash_end;
+			}
+			active_shader->set_dash_pattern(
+				dash_ends, nr_dashes, stroke_dash_phase);
+		}
+
 		if(do_color_transform)
 			active_shader->set_color_transform(
 				color_transform_scale,
 				color_transform_bias);
 
-		switch(pipeline_mode) {
-		case VG_COLOR_RAMP_SPREAD_MODE_FORCE_SIZE:
-			break;
-		case VG_FILL_PATH:
-			active_shader->set_surf2paint_matrix(surf2fill_matrix_data);
-			break;
-		case VG_STROKE_PATH:
-			active_shader->set_surf2paint_matrix(surf2stroke_matrix_data);
-			break;
-		}
-
 		if(mask_is_active) active_shader->set_mask_texture(mask.texture);
 
-		if(scissors_are_active) {
-			glEnable(GL_STENCIL_TEST);
-			glStencilMask(0x00);
-			glStencilFunc(GL_EQUAL,
-				      1,
-				      0xff);
-			glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
-		} else {
-			glStencilFunc(GL_ALWAYS, 1, 1);
-			glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
-			glDisable(GL_STENCIL_TEST);
-		}
+		use_scissor_stencil();
 
-		switch(active_paint->ptype) {
+		switch(active_paint->get_paint_type()) {
 		case VG_PAINT_TYPE_FORCE_SIZE:
 			break;
 
 		case VG_PAINT_TYPE_PATTERN:
-			if(active_paint->pattern) {
-				auto ptf = active_paint->pattern->get_framebuffer();
+			if(active_paint->get_pattern()) {
+				auto ptf = active_paint->get_pattern()->get_framebuffer();
 				prepare_framebuffer_matrix(ptf);
 				active_shader->set_pattern_texture(ptf->texture);
+				use_texture_filter(ptf);
 
 				GLint wrap_mode = GL_CLAMP_TO_EDGE;
-				switch(active_paint->tiling_mode) {
+				switch(active_paint->get_tiling_mode()) {
 				case VG_TILING_MODE_FORCE_SIZE: // for compiler warning elimination
 				case VG_TILE_FILL: // not supported - implement as PAD
 				case VG_TILE_PAD:
@@ -1342,35 +1653,171 @@ namespace gnuVG {
 					wrap_mode = GL_MIRRORED_REPEAT;
 					break;
 				}
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap_mode);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap_mode);
+				use_texture_wrap(ptf, wrap_mode);
 
 				active_shader->set_pattern_matrix(image_matrix_data);
 			}
 			break;
 
 		case VG_PAINT_TYPE_COLOR:
-			active_shader->set_color(active_paint->color.c);
+			active_shader->set_color(active_paint->get_color().c,
+						 active_paint->get_version());
 			return;
 
 		case VG_PAINT_TYPE_LINEAR_GRADIENT:
-			active_shader->set_linear_parameters(active_paint->gradient_parameters);
-			active_shader->set_color_ramp(
-				active_paint->max_stops,
-				active_paint->color_ramp_stop_offset,
-				active_paint->color_ramp_stop_invfactor,
-				active_paint->color_ramp_stop_color);
+			use_surf2paint_matrix();
+			active_shader->set_linear_parameters(active_paint->get_gradient_parameters(),
+							     active_paint->get_version());
 			break;
 
 		case VG_PAINT_TYPE_RADIAL_GRADIENT:
-			active_shader->set_radial_parameters(active_paint->gradient_parameters);
-			active_shader->set_color_ramp(
-				active_paint->max_stops,
-				active_paint->color_ramp_stop_offset,
-				active_paint->color_ramp_stop_invfactor,
-				active_paint->color_ramp_stop_color);
+			use_surf2paint_matrix();
+			active_shader->set_radial_parameters(active_paint->get_gradient_parameters(),
+							     active_paint->get_version());
 			break;
 		}
+
+		if(caps & Shader::do_two_stop_ramp)
+			active_shader->set_two_stop_ramp(
+				active_paint->get_color_ramp_stop_offsets(),
+				active_paint->get_color_ramp_stop_invfactors(),
+				active_paint->get_color_ramp_stop_colors(),
+				active_paint->get_ramp_version());
+		else if(gradient_enabled)
+			active_shader->set_color_ramp(
+				color_ramps.get_texture(),
+				color_ramps.get_row(active_paint.get()));
+	}
+
+	void Context::use_scissor_stencil() {
+		if(scissors_are_active) {
+			gl_state.set_stencil_test(true);
+			gl_state.stencil_mask(0x00);
+			gl_state.stencil_func(GL_EQUAL,
+					      1,
+					      0xff);
+			gl_state.stencil_op(GL_KEEP, GL_KEEP, GL_KEEP);
+		} else {
+			gl_state.stencil_func(GL_ALWAYS, 1, 1);
+			gl_state.stencil_op(GL_KEEP, GL_KEEP, GL_KEEP);
+			gl_state.set_stencil_test(false);
+		}
+	}
+
+	void Context::append_to_batch(GLenum primitive,
+				      const GLushort *indices, GLsizei nr_indices) {
+		ADD_GNUVG_PROFILER_PROBE(append_to_batch);
+
+		if(primitive != batch_primitive ||
+		   batch_vertices.size() / 6 + batch_source_count > GNUVG_MAX_INDEXED_VERTICES)
+			render_batch();
+		batch_primitive = primitive;
+
+		auto base = batch_vertices.size() / 6;
+		auto stride = batch_source_stride ? batch_source_stride : 2;
+		auto m = &final_matrix[conversion_matrix];
+
+		// transform all positions in one go, pre translation included
+		Matrix to_gl;
+		to_gl.set_to(*m);
+		to_gl.translate(pre_translation[0], pre_translation[1]);
+		batch_positions.resize(batch_source_count);
+		if(stride == 2) {
+			to_gl.map_points(reinterpret_cast<const Point*>(batch_source),
+					 batch_positions.data(), batch_source_count);
+		} else {
+			auto v = batch_source;
+			for(GLsizei k = 0; k < batch_source_count; ++k, v += stride) {
+				batch_positions[k].x = v[0];
+				batch_positions[k].y = v[1];
+			}
+			to_gl.map_points(batch_positions.data(),
+					 batch_positions.data(), batch_source_count);
+		}
+
+		auto v = batch_source;
+		for(GLsizei k = 0; k < batch_source_count; ++k, v += stride) {
+			auto gl_x = batch_positions[k].x;
+			auto gl_y = batch_positions[k].y;
+
+			if(batch_source_is_stroke) {
+				// same as the do_stroke_extrusion shader
+				auto ex = v[2] * m->a + v[3] * m->d;
+				auto ey = v[2] * m->b + v[3] * m->e;
+				auto scale = stroke_width;
+				if(non_scaling_stroke) {
+					auto px = ex * 0.5f * buffer_width;
+					auto py = ey * 0.5f * buffer_height;
+					auto pixels = sqrtf(px * px + py * py);
+					scale = pixels > 0.0f ?
+						stroke_width * sqrtf(v[2] * v[2] + v[3] * v[3]) / pixels :
+						0.0f;
+				}
+				gl_x += ex * scale;
+				gl_y += ey * scale;
+			}
+
+			batch_vertices.push_back(gl_x);
+			batch_vertices.push_back(gl_y);
+			batch_vertices.insert(batch_vertices.end(),
+					      batch_color, batch_color + 3);
+			batch_vertices.push_back(
+				batch_source_has_coverage ?
+				batch_color[3] * v[2] : batch_color[3]);
+		}
+		for(GLsizei k = 0; k < nr_indices; ++k)
+			batch_indices.push_back(base + indices[k]);
+	}
+
+	void Context::render_batch() {
+		if(batch_indices.size() == 0) return;
+		ADD_GNUVG_PROFILER_COUNTER(render_batch, batch_indices.size());
+
+		static const GLfloat identity[] = {
+			1.0f, 0.0f, 0.0f, 0.0f,
+			0.0f, 1.0f, 0.0f, 0.0f,
+			0.0f, 0.0f, 1.0f, 0.0f,
+			0.0f, 0.0f, 0.0f, 1.0f
+		};
+
+		active_shader = Shader::get_shader(batch_caps);
+		active_shader->use_shader(batch_caps);
+		active_shader->set_blending(batch_blend_mode);
+		active_shader->set_matrix(identity);
+
+		if(batch_caps & Shader::do_color_transform)
+			active_shader->set_color_transform(
+				color_transform_scale,
+				color_transform_bias);
+
+		if(batch_caps & Shader::do_mask)
+			active_shader->set_mask_texture(mask.texture);
+
+		use_scissor_stencil();
+
+		auto offset = vertex_stream.append(batch_vertices.data(),
+						   batch_vertices.size() * sizeof(GLfloat));
+		active_shader->load_2dvertex_array(
+			stream_offset<GLfloat>(offset), 6);
+		active_shader->load_vertex_color_array(
+			stream_offset<GLfloat>(offset + 2 * sizeof(GLfloat)), 6);
+
+		offset = index_stream.append(batch_indices.data(),
+					     batch_indices.size() * sizeof(GLushort));
+		if(batch_primitive == GL_LINES)
+			active_shader->render_line_elements(
+				stream_offset<GLushort>(offset), batch_indices.size());
+		else
+			active_shader->render_elements(
+				stream_offset<GLushort>(offset), batch_indices.size());
+
+		batch_vertices.clear();
+		batch_indices.clear();
+	}
+
+	void Context::flush_batch() {
+		render_batch();
+		batching = false;
 	}
 
 	void Context::reset_pre_translation() {
@@ -1388,14 +1835,92 @@ namespace gnuVG {
 			glyph_origin[k] += escapement[k];
 	}
 
-	void Context::load_2dvertex_array(const GLfloat *verts, GLint stride) {
+	void Context::load_2dvertex_array(const GLfloat *verts, GLint stride,
+					  GLsizei nr_vertices) {
+		if(batching) {
+			batch_source = verts;
+			batch_source_stride = stride;
+			batch_source_count = nr_vertices;
+			batch_source_is_stroke = false;
+			batch_source_has_coverage = false;
+			return;
+		}
+		if(active_shader) {
+			auto offset = vertex_stream.append(
+				verts, vertex_array_size(stride, nr_vertices));
+			active_shader->load_2dvertex_array(
+				stream_offset<GLfloat>(offset), stride);
+			active_shader->set_full_coverage();
+		}
+	}
+
+	void Context::load_coverage_vertex_array(const GLfloat *verts, GLsizei nr_vertices) {
+		if(batching) {
+			batch_source = verts;
+			batch_source_stride = 3;
+			batch_source_count = nr_vertices;
+			batch_source_is_stroke = false;
+			batch_source_has_coverage = true;
+			return;
+		}
 		if(active_shader) {
-			active_shader->load_2dvertex_array(verts, stride);
+			auto offset = vertex_stream.append(
+				verts, vertex_array_size(3, nr_vertices));
+			active_shader->load_2dvertex_array(
+				stream_offset<GLfloat>(offset), 3);
+			active_shader->load_coverage_array(
+				stream_offset<GLfloat>(offset + 2 * sizeof(GLfloat)), 3);
+		}
+	}
+
+	void Context::load_stroke_vertex_array(const GLfloat *verts, GLsizei nr_vertices) {
+		if(batching) {
+			batch_source = verts;
+			batch_source_stride = GNUVG_STROKE_VERTEX_SIZE;
+			batch_source_count = nr_vertices;
+			batch_source_is_stroke = true;
+			batch_source_has_coverage = false;
 			return;
 		}
+		if(active_shader) {
+			auto offset = vertex_stream.append(
+				verts, vertex_array_size(GNUVG_STROKE_VERTEX_SIZE, nr_vertices));
+			active_shader->load_2dvertex_array(
+				stream_offset<GLfloat>(offset), GNUVG_STROKE_VERTEX_SIZE);
+			active_shader->load_extrusion_array(
+				stream_offset<GLfloat>(offset + 2 * sizeof(GLfloat)),
+				GNUVG_STROKE_VERTEX_SIZE);
+			active_shader->load_arc_length_array(
+				stream_offset<GLfloat>(offset + 4 * sizeof(GLfloat)),
+				GNUVG_STROKE_VERTEX_SIZE);
+			active_shader->load_disc_array(
+				stream_offset<GLfloat>(offset + 5 * sizeof(GLfloat)),
+				GNUVG_STROKE_VERTEX_SIZE);
+			active_shader->load_side_array(
+				stream_offset<GLfloat>(offset + 6 * sizeof(GLfloat)),
+				GNUVG_STROKE_VERTEX_SIZE);
+		}
+	}
+
+	void Context::load_2dvertex_texture_array(const GLfloat *verts, GLint stride,
+						  GLsizei nr_vertices) {
+		if(active_shader) {
+			auto offset = vertex_stream.append(
+				verts, vertex_array_size(stride, nr_vertices));
+			active_shader->load_2dvertex_texture_array(
+				stream_offset<GLfloat>(offset), stride);
+			active_shader->set_full_coverage();
+		}
 	}
 
 	void Context::render_triangles(GLint first, GLsizei count) {
+		if(batching) {
+			mesh_indices.clear();
+			for(GLsizei k = 0; k < count; ++k)
+				mesh_indices.push_back(first + k);
+			append_to_batch(GL_TRIANGLES, mesh_indices.data(), count);
+			return;
+		}
 		if(active_shader) {
 			active_shader->render_triangles(first, count);
 			return;
@@ -1403,14 +1928,84 @@ namespace gnuVG {
 		glDrawArrays(GL_TRIANGLES, first, count);
 	}
 
-	void Context::render_elements(const GLuint *indices, GLsizei nr_indices) {
+	void Context::render_elements(const GLushort *indices, GLsizei nr_indices) {
 		ADD_GNUVG_PROFILER_COUNTER(render_elements, nr_indices);
+		if(batching) {
+			append_to_batch(GL_TRIANGLES, indices, nr_indices);
+			return;
+		}
+		auto offset = index_stream.append(indices, nr_indices * sizeof(GLushort));
 		if(active_shader) {
-			active_shader->render_elements(indices, nr_indices);
+			active_shader->render_elements(
+				stream_offset<GLushort>(offset), nr_indices);
 			return;
 		}
 		ADD_GNUVG_PROFILER_PROBE(render_elements);
-		glDrawElements(GL_TRIANGLES, nr_indices, GL_UNSIGNED_INT, indices);
+		glDrawElements(GL_TRIANGLES, nr_indices, GL_UNSIGNED_SHORT,
+			       stream_offset<GLvoid>(offset));
+	}
+
+	void Context::render_line_elements(const GLushort *indices, GLsizei nr_indices) {
+		ADD_GNUVG_PROFILER_COUNTER(render_line_elements, nr_indices);
+		if(batching) {
+			append_to_batch(GL_LINES, indices, nr_indices);
+			return;
+		}
+		auto offset = index_stream.append(indices, nr_indices * sizeof(GLushort));
+		if(active_shader)
+			active_shader->render_line_elements(
+				stream_offset<GLushort>(offset), nr_indices);
+	}
+
+	void Context::render_mesh_chunk() {
+		load_2dvertex_array(mesh_vertices.data(), 0, mesh_vertices.size() >> 1);
+		render_elements(mesh_indices.data(), mesh_indices.size());
+
+		// forget the vertices of this chunk
+		for(auto original : mesh_remapped)
+			mesh_remap[original] = -1;
+		mesh_remapped.clear();
+		mesh_vertices.clear();
+		mesh_indices.clear();
+	}
+
+	void Context::render_mesh(const GLfloat *vertices, GLsizei nr_vertices,
+				  const GLuint *indices, GLsizei nr_indices) {
+		ADD_GNUVG_PROFILER_PROBE(render_mesh);
+
+		mesh_indices.clear();
+		if(nr_vertices <= GNUVG_MAX_INDEXED_VERTICES) {
+			for(GLsizei k = 0; k < nr_indices; ++k)
+				mesh_indices.push_back((GLushort)indices[k]);
+			load_2dvertex_array(vertices, 0, nr_vertices);
+			render_elements(mesh_indices.data(), nr_indices);
+			return;
+		}
+
+		/* Too many vertices for 16-bit indices, split the
+		 * triangles into chunks that each reference at most
+		 * GNUVG_MAX_INDEXED_VERTICES vertices.
+		 */
+		mesh_vertices.clear();
+		mesh_remapped.clear();
+		mesh_remap.assign(nr_vertices, -1);
+		for(GLsizei k = 0; k + 2 < nr_indices; k += 3) {
+			if(mesh_remapped.size() + 3 > GNUVG_MAX_INDEXED_VERTICES)
+				render_mesh_chunk();
+
+			for(auto l = 0; l < 3; ++l) {
+				auto original = indices[k + l];
+				if(mesh_remap[original] < 0) {
+					mesh_remap[original] = mesh_remapped.size();
+					mesh_remapped.push_back(original);
+					mesh_vertices.push_back(vertices[original << 1]);
+					mesh_vertices.push_back(vertices[(original << 1) + 1]);
+				}
+				mesh_indices.push_back((GLushort)mesh_remap[original]);
+			}
+		}
+		if(mesh_indices.size())
+			render_mesh_chunk();
 	}
 
 	static inline void add_to_bounding_box(Point* bbox, const Point& p) {
@@ -1427,9 +2022,7 @@ namespace gnuVG {
 
 	void Context::calculate_bounding_box(Point* bbox) {
 		Point transformed[4];
-		for(int k = 0; k < 4; k++) {
-			transformed[k] = matrix[conversion_matrix].map_point(bbox[k]);
-		}
+		matrix[conversion_matrix].map_points(bbox, transformed, 4);
 
 		int k = 0;
 		if(bounding_box_was_reset) {
@@ -1446,9 +2039,7 @@ namespace gnuVG {
 
 	void Context::transform_bounding_box(Point* bbox, VGfloat *sp_ep) {
 		Point transformed[4];
-		for(int k = 0; k < 4; k++) {
-			transformed[k] = matrix[conversion_matrix].map_point(bbox[k]);
-		}
+		matrix[conversion_matrix].map_points(bbox, transformed, 4);
 
 		Point bounding_box[2];
 
@@ -1471,14 +2062,17 @@ namespace gnuVG {
 	}
 
 	void Context::switch_mask_to(gnuVGFrameBuffer to_this_temporary) {
+		flush_batch();
+
+		use_internal_buffer(&mask);
 		auto temporary = mask;
 		switch(to_this_temporary) {
 		case Context::GNUVG_TEMPORARY_A:
-			mask = temporary_a;
+			mask = *use_internal_buffer(&temporary_a);
 			temporary_a = temporary;
 			break;
 		case Context::GNUVG_TEMPORARY_B:
-			mask = temporary_b;
+			mask = *use_internal_buffer(&temporary_b);
 			temporary_b = temporary;
 			break;
 		default:
@@ -1488,70 +2082,302 @@ namespace gnuVG {
 		}
 	}
 
-	bool Context::create_framebuffer(FrameBuffer* destination,
-					 VGImageFormat format,
-					 VGint w, VGint h,
-					 VGbitfield allowedQuality) {
-		destination->width = w;
-		destination->height = h;
-		glGenFramebuffers(1, &destination->framebuffer);
-		glGenTextures(1, &destination->texture);
-		glGenRenderbuffers(1, &destination->stencil);
-
-		glBindRenderbuffer(GL_RENDERBUFFER, destination->stencil);
-		glRenderbufferStorage(GL_RENDERBUFFER,
-				      GL_STENCIL_INDEX8,
-				      w, h);
-
-		glBindTexture(GL_TEXTURE_2D, destination->texture);
-		glTexImage2D(GL_TEXTURE_2D, 0,
-			     GL_RGBA, w, h, 0,
-			     GL_RGBA, GL_UNSIGNED_SHORT_4_4_4_4,
-			     NULL);
-		checkGlError("::create_framebuffer - glTexImage2D");
+	// the texture storage of an image format, alpha and luminance
+	// take a byte per pixel, formats of 8 bits per channel four
+	static bool storage_for_format(VGImageFormat format,
+				       GLenum &texture_format, GLenum &texture_type) {
+		texture_type = GL_UNSIGNED_BYTE;
+		switch(format & 0x3f) { // the channel order does not matter here
+		case VG_sRGBX_8888:
+		case VG_sRGBA_8888:
+		case VG_sRGBA_8888_PRE:
+		case VG_lRGBX_8888:
+		case VG_lRGBA_8888:
+		case VG_lRGBA_8888_PRE:
+			texture_format = GL_RGBA;
+			return true;
+		case VG_sRGB_565:
+			texture_format = GL_RGB;
+			texture_type = GL_UNSIGNED_SHORT_5_6_5;
+			return true;
+		case VG_sRGBA_5551:
+			texture_format = GL_RGBA;
+			texture_type = GL_UNSIGNED_SHORT_5_5_5_1;
+			return true;
+		case VG_sRGBA_4444:
+			texture_format = GL_RGBA;
+			texture_type = GL_UNSIGNED_SHORT_4_4_4_4;
+			return true;
+		case VG_sL_8:
+		case VG_lL_8:
+		case VG_BW_1:
+			texture_format = GL_LUMINANCE;
+			return true;
+		case VG_A_8:
+		case VG_A_1:
+		case VG_A_4:
+			texture_format = GL_ALPHA;
+			return true;
+		}
+		return false;
+	}
+
+	// GLES2 can't render to alpha textures, coverage is kept in
+	// the red channel of a one byte texture where GL_EXT_texture_rg
+	// makes those renderable, and in RGBA 4444 where it doesn't
+	static int texture_rg_supported = -1;
+	static GLenum red_internal_format = GL_RED_EXT;
+
+	static void coverage_storage(GLenum &texture_format, GLenum &texture_type) {
+		if(texture_rg_supported < 0) {
+			auto version = (const char *)glGetString(GL_VERSION);
+			auto extensions = (const char *)glGetString(GL_EXTENSIONS);
+			bool es3 = version && strncmp(version, "OpenGL ES 3", 11) == 0;
+			texture_rg_supported = (es3 ||
+						(extensions &&
+						 strstr(extensions, "GL_EXT_texture_rg"))) ? 1 : 0;
+			// ES3 only takes the sized internal format
+			if(es3)
+				red_internal_format = GL_R8_EXT;
+		}
+		if(texture_rg_supported == 1) {
+			texture_format = GL_RED_EXT;
+			texture_type = GL_UNSIGNED_BYTE;
+		} else {
+			texture_format = GL_RGBA;
+			texture_type = GL_UNSIGNED_SHORT_4_4_4_4;
+		}
+	}
 
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	static int bytes_per_pixel(GLenum texture_format, GLenum texture_type) {
+		if(texture_format == GL_ALPHA || texture_format == GL_LUMINANCE ||
+		   texture_format == GL_RED_EXT)
+			return 1;
+		if(texture_type != GL_UNSIGNED_BYTE)
+			return 2;
+		return texture_format == GL_RGB ? 3 : 4;
+	}
+
+	// pack RGBA bytes into the storage of a texture
+	static void convert_from_rgba8888(const GLubyte *src, int nr_pixels,
+					  GLenum texture_format, GLenum texture_type,
+					  GLubyte *dst) {
+		auto dst16 = (GLushort *)dst;
+		for(int k = 0; k < nr_pixels; k++, src += 4) {
+			GLuint r = src[0], g = src[1], b = src[2], a = src[3];
+			if(texture_format == GL_ALPHA)
+				dst[k] = a;
+			else if(texture_format == GL_LUMINANCE)
+				dst[k] = (54 * r + 183 * g + 19 * b) >> 8;
+			else if(texture_type == GL_UNSIGNED_SHORT_5_6_5)
+				dst16[k] = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+			else if(texture_type == GL_UNSIGNED_SHORT_5_5_5_1)
+				dst16[k] = ((r >> 3) << 11) | ((g >> 3) << 6) |
+					((b >> 3) << 1) | (a >> 7);
+			else if(texture_type == GL_UNSIGNED_SHORT_4_4_4_4)
+				dst16[k] = ((r >> 4) << 12) | ((g >> 4) << 8) |
+					((b >> 4) << 4) | (a >> 4);
+			else
+				memcpy(dst + 4 * k, src, 4);
+		}
+	}
+
+	// widen alpha or luminance bytes to RGBA, the way
+	// the texture they were promoted from was sampled
+	static void convert_to_rgba8888(const GLubyte *src, int nr_pixels,
+					GLenum data_format, GLubyte *dst) {
+		for(int k = 0; k < nr_pixels; k++, dst += 4) {
+			if(data_format == GL_ALPHA) {
+				dst[0] = dst[1] = dst[2] = 0;
+				dst[3] = src[k];
+			} else {
+				dst[0] = dst[1] = dst[2] = src[k];
+				dst[3] = 255;
+			}
+		}
+	}
 
-		if(allowedQuality == VG_IMAGE_QUALITY_BETTER) {
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	void Context::allocate_texture(const FrameBuffer* fb) {
+		glGenTextures(1, &fb->texture);
+
+		auto internal_format = fb->texture_format == GL_RED_EXT ?
+			red_internal_format : fb->texture_format;
+
+		// unit 0 is never sampled from, we use it for updates
+		gl_state.bind_texture(0, fb->texture);
+		if(fb->texture_format == GL_ALPHA || fb->texture_format == GL_LUMINANCE) {
+			// they can't be rendered to, so they can't be cleared with glClear
+			std::vector<GLubyte> zero(fb->width * fb->height, 0);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			glTexImage2D(GL_TEXTURE_2D, 0,
+				     internal_format, fb->width, fb->height, 0,
+				     fb->texture_format, fb->texture_type,
+				     zero.data());
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 		} else {
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexImage2D(GL_TEXTURE_2D, 0,
+				     internal_format, fb->width, fb->height, 0,
+				     fb->texture_format, fb->texture_type,
+				     NULL);
+
+			// the texture has no framebuffer of its own yet
+			if(clearing_framebuffer == 0)
+				glGenFramebuffers(1, &clearing_framebuffer);
+			glBindFramebuffer(GL_FRAMEBUFFER, clearing_framebuffer);
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+					       GL_TEXTURE_2D, fb->texture, 0);
+			glClearColor(0, 0, 0, 0.0);
+			glClear(GL_COLOR_BUFFER_BIT);
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+					       GL_TEXTURE_2D, 0, 0);
+			glBindFramebuffer(GL_FRAMEBUFFER, current_framebuffer->framebuffer);
 		}
+		checkGlError("::allocate_texture - glTexImage2D");
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		fb->wrap = GL_CLAMP_TO_EDGE;
 
-		glBindFramebuffer(GL_FRAMEBUFFER, destination->framebuffer);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, fb->filter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, fb->filter);
+	}
+
+	bool Context::attach_framebuffer(const FrameBuffer* fb) {
+		ADD_GNUVG_PROFILER_PROBE(attach_framebuffer);
+
+		glGenFramebuffers(1, &fb->framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, fb->framebuffer);
 
 		// specify texture as color attachment
 		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
-				       destination->texture, 0 );
-		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT,
-				GL_RENDERBUFFER, destination->stencil);
+				       fb->texture, 0 );
 
-		// clear it completely
-		glClearColor(0, 0, 0, 0.0);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		auto complete =
+			glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
 
 		glBindFramebuffer(GL_FRAMEBUFFER, current_framebuffer->framebuffer);
 
-		return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+		return complete;
+	}
+
+	void Context::attach_stencil(const FrameBuffer* fb) {
+		auto &shared = shared_stencils[std::make_pair(fb->width, fb->height)];
+		if(shared.users++ == 0) {
+			glGenRenderbuffers(1, &shared.renderbuffer);
+			glBindRenderbuffer(GL_RENDERBUFFER, shared.renderbuffer);
+			glRenderbufferStorage(GL_RENDERBUFFER,
+					      GL_STENCIL_INDEX8,
+					      fb->width, fb->height);
+		}
+		fb->stencil = shared.renderbuffer;
+
+		// fb is bound, see render_scissors()
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT,
+					  GL_RENDERBUFFER, fb->stencil);
+	}
+
+	void Context::release_stencil(const FrameBuffer* fb) {
+		auto k = shared_stencils.find(std::make_pair(fb->width, fb->height));
+		if(k != shared_stencils.end() && --(k->second.users) == 0) {
+			glDeleteRenderbuffers(1, &k->second.renderbuffer);
+			shared_stencils.erase(k);
+		}
+		fb->stencil = 0;
+	}
+
+	void Context::make_renderable(const FrameBuffer* fb) {
+		ADD_GNUVG_PROFILER_PROBE(make_renderable);
+
+		FrameBuffer previous = *fb;
+
+		fb->texture_format = GL_RGBA;
+		fb->texture_type = GL_UNSIGNED_BYTE;
+		allocate_texture(fb);
+		if(!attach_framebuffer(fb))
+			GNUVG_ERROR("failed to make framebuffer for %dx%d image.\n",
+				    fb->width, fb->height);
+
+		// the whole image is copied, whatever the scissors
+		auto scissoring = scissors_are_active;
+		scissors_are_active = false;
+		copy_framebuffer_to_framebuffer(fb, &previous,
+						0, 0, 0, 0,
+						fb->width, fb->height);
+		scissors_are_active = scissoring;
+
+		gl_state.forget_texture(previous.texture);
+		glDeleteTextures(1, &previous.texture);
+	}
+
+	bool Context::create_framebuffer(FrameBuffer* destination,
+					 VGImageFormat format,
+					 VGint w, VGint h,
+					 VGbitfield allowedQuality) {
+		if(!storage_for_format(format,
+				       destination->texture_format,
+				       destination->texture_type)) {
+			GNUVG_ERROR("Unsupported image format %d.\n", format);
+			return false;
+		}
+		allocate_framebuffer(destination, format, w, h, allowedQuality);
+		return true;
+	}
+
+	bool Context::create_coverage_framebuffer(FrameBuffer* destination,
+						  VGint w, VGint h,
+						  VGbitfield allowedQuality) {
+		coverage_storage(destination->texture_format,
+				 destination->texture_type);
+		allocate_framebuffer(destination, VG_A_8, w, h, allowedQuality);
+		return true;
+	}
+
+	void Context::allocate_framebuffer(FrameBuffer* destination,
+					   VGImageFormat format,
+					   VGint w, VGint h,
+					   VGbitfield allowedQuality) {
+		destination->width = w;
+		destination->height = h;
+		destination->format = format;
+		destination->holds_data = false;
+
+		destination->allow_linear_filter = allowedQuality == VG_IMAGE_QUALITY_BETTER;
+		destination->filter =
+			destination->allow_linear_filter ? GL_LINEAR : GL_NEAREST;
+
+		// the framebuffer is attached when first rendered to,
+		// images that are only sampled never get one
+		allocate_texture(destination);
 	}
 
 	void Context::delete_framebuffer(FrameBuffer* framebuffer) {
+		flush_batch();
 		if(framebuffer == current_framebuffer) {
 			render_to_framebuffer(&screen_buffer);
 		}
+		if(framebuffer->stencil != 0)
+			release_stencil(framebuffer);
 		glDeleteFramebuffers(1, &framebuffer->framebuffer);
+		gl_state.forget_texture(framebuffer->texture);
 		glDeleteTextures(1, &framebuffer->texture);
-		glDeleteRenderbuffers(1, &framebuffer->stencil);
 		framebuffer->framebuffer = 0;
 		framebuffer->texture = 0;
-		framebuffer->stencil = 0;
 	}
 
 	void Context::render_to_framebuffer(const FrameBuffer* framebuffer) {
+		flush_batch();
+
+		if(framebuffer && framebuffer->framebuffer == 0 && framebuffer->texture != 0) {
+			if(framebuffer->texture_format == GL_ALPHA ||
+			   framebuffer->texture_format == GL_LUMINANCE)
+				make_renderable(framebuffer);
+			else if(!attach_framebuffer(framebuffer))
+				GNUVG_ERROR("failed to make framebuffer for %dx%d image.\n",
+					    framebuffer->width, framebuffer->height);
+		}
+
 		current_framebuffer = framebuffer == nullptr ? (&screen_buffer) : framebuffer;
+		current_framebuffer->holds_data = true;
 
 		glBindFramebuffer(GL_FRAMEBUFFER, current_framebuffer->framebuffer);
 		render_scissors();
@@ -1575,11 +2401,11 @@ namespace gnuVG {
 		case Context::GNUVG_CURRENT_FRAMEBUFFER:
 			return current_framebuffer;
 		case Context::GNUVG_TEMPORARY_A:
-			return &temporary_a;
+			return use_internal_buffer(&temporary_a);
 		case Context::GNUVG_TEMPORARY_B:
-			return &temporary_b;
+			return use_internal_buffer(&temporary_b);
 		case Context::GNUVG_MASK_BUFFER:
-			return &mask;
+			return use_internal_buffer(&mask);
 		}
 		GNUVG_ERROR("Context::get_internal_framebuffer() returning nullptr\n");
 		return nullptr;
@@ -1592,7 +2418,7 @@ namespace gnuVG {
 		         k != available_temporary_framebuffers.end();
 		    k++) {
 			auto f = (*k);
-			if(f->width == w && f->height == h) {
+			if(f->width == w && f->height == h && f->format == format) {
 				available_temporary_framebuffers.erase(k);
 				return f;
 			}
@@ -1606,6 +2432,7 @@ namespace gnuVG {
 	}
 
 	void Context::return_temporary_framebuffer(FrameBuffer *fbf) {
+		fbf->last_use = std::chrono::steady_clock::now();
 		available_temporary_framebuffers.push_back(fbf);
 	}
 
@@ -1621,6 +2448,8 @@ namespace gnuVG {
 
 		auto caps = Shader::do_pattern;
 		auto shader = Shader::get_shader(caps);
+		active_shader = shader;
+		shader->use_shader(caps);
 
 		if(do_blend)
 			shader->set_blending(Shader::blend_src_over);
@@ -1628,37 +2457,45 @@ namespace gnuVG {
 			shader->set_blending(Shader::blend_src);
 
 		shader->set_pattern_texture(src->texture);
-		shader->set_pattern_size(_width, _height);
-		shader->set_wrap_mode(GL_CLAMP_TO_EDGE);
+		use_texture_wrap(src, GL_CLAMP_TO_EDGE);
+
+		// the vertices are given in clip space, which the
+		// pattern matrix maps to the texture coordinates of src
+		GLfloat identity[] = {
+			1.0, 0.0, 0.0, 0.0,
+			0.0, 1.0, 0.0, 0.0,
+			0.0, 0.0, 1.0, 0.0,
+			0.0, 0.0, 0.0, 1.0
+		};
+		shader->set_matrix(identity);
 
+		GLfloat half_w = 0.5f * dst->width, half_h = 0.5f * dst->height;
 		GLfloat mtrx[] = {
-			1.0, 0.0, 0.0, (GLfloat)(sx - dx),
-			0.0, 1.0, 0.0, (GLfloat)(sy - dy),
-			0.0, 0.0, 1.0,     0.0,
-			0.0, 0.0, 0.0,     1.0
+			half_w / src->width, 0.0, 0.0, 0.0,
+			0.0, half_h / src->height, 0.0, 0.0,
+			0.0, 0.0, 1.0, 0.0,
+			(half_w + sx - dx) / src->width, (half_h + sy - dy) / src->height, 0.0, 1.0
 		};
 
 		shader->set_pattern_matrix(mtrx);
 
-		VGfloat x = (VGfloat)dx;
-		VGfloat y = (VGfloat)dy;
-		VGfloat width = (VGfloat)_width;
-		VGfloat height = (VGfloat)_height;
+		auto c1 = screen_matrix.map_point(Point(dx, dy));
+		auto c2 = screen_matrix.map_point(Point(dx + _width, dy + _height));
 
 		GLfloat vertices[] = {
-			x,         y,
-			x + width, y,
-			x + width, y + height,
-			x        , y + height
+			c1.x, c1.y,
+			c2.x, c1.y,
+			c2.x, c2.y,
+			c1.x, c2.y
 		};
 
-		GLuint indices[] = {
+		GLushort indices[] = {
 			0, 1, 2,
 			0, 2, 3
 		};
 
-		shader->load_2dvertex_array(vertices, 0);
-		shader->render_elements(indices, 6);
+		load_2dvertex_array(vertices, 0, 4);
+		render_elements(indices, 6);
 
 		restore_current_framebuffer();
 	}
@@ -1680,26 +2517,69 @@ namespace gnuVG {
 			return; /* can't copy directly to framebuffer */
 		}
 
-		if(fmt != VG_sRGBA_8888) {
-			GNUVG_ERROR("Only VG_sRGBA_8888 is supported currently.\n");
+		// data in the storage format of the texture is uploaded
+		// as is, VG_sRGBA_8888 is converted to it when it differs
+		GLenum data_format, data_type;
+		bool stored = (fmt & ~0x3f) == 0 &&
+			fmt != VG_BW_1 && fmt != VG_A_1 && fmt != VG_A_4 &&
+			storage_for_format(fmt, data_format, data_type);
+		bool as_is = stored &&
+			data_format == dst->texture_format &&
+			data_type == dst->texture_type;
+
+		// alpha and luminance images rendered to were promoted
+		// to RGBA, data in their own format is widened to it
+		bool widen = stored && !as_is && fmt == dst->format &&
+			(data_format == GL_ALPHA || data_format == GL_LUMINANCE) &&
+			dst->texture_format == GL_RGBA &&
+			dst->texture_type == GL_UNSIGNED_BYTE;
+		if(!as_is && !widen && fmt != VG_sRGBA_8888) {
+			GNUVG_ERROR("Only VG_sRGBA_8888, or the format of the image, "
+				    "is supported currently.\n");
 			return;
 		}
 
-		if(stride != 0) {
-			GNUVG_ERROR("stride not supported for copying memory to and from an image.\n");
-			return;
+		// rows are packed, and converted, when needed
+		auto data_bpp = (as_is || widen) ?
+			bytes_per_pixel(data_format, data_type) : 4;
+		auto bpp = bytes_per_pixel(dst->texture_format, dst->texture_type);
+		if(stride == 0)
+			stride = width * data_bpp;
+		std::vector<GLubyte> packed;
+		if(!as_is || stride != width * data_bpp) {
+			packed.resize(width * height * bpp);
+			for(int row = 0; row < height; row++) {
+				auto src = (const GLubyte *)memory + row * stride;
+				auto dst_row = packed.data() + row * width * bpp;
+				if(as_is)
+					memcpy(dst_row, src, width * bpp);
+				else if(widen)
+					convert_to_rgba8888(src, width,
+							    data_format, dst_row);
+				else
+					convert_from_rgba8888(src, width,
+							      dst->texture_format,
+							      dst->texture_type,
+							      dst_row);
+			}
+			memory = packed.data();
 		}
 
 		checkGlError("::copy_memory_to_framebuffer - glTexSubImage2D (before)");
 		GNUVG_DEBUG("glTexSubImage2D(%d, 0, %d, %d, %d, %d, %d, %d, %p)\n",
-			    dst->texture, x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE,
+			    dst->texture, x, y, width, height,
+			    dst->texture_format, dst->texture_type,
 			    memory);
-		glBindTexture(GL_TEXTURE_2D, dst->texture);
+		gl_state.bind_texture(0, dst->texture);
+		if(bpp != 4)
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 		glTexSubImage2D(GL_TEXTURE_2D,
 				0,
 				x, y, width, height,
-				GL_RGBA, GL_UNSIGNED_BYTE,
+				dst->texture_format, dst->texture_type,
 				memory);
+		if(bpp != 4)
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 		checkGlError("::copy_memory_to_framebuffer - glTexSubImage2D");
 	}
 
@@ -1881,6 +2761,14 @@ extern "C" {
 		gnuVG::Context::get_current()->clear(x, y, width, height);
 	}
 
+	void VG_API_ENTRY vgFlush(void) VG_API_EXIT {
+		gnuVG::Context::get_current()->vgFlush();
+	}
+
+	void VG_API_ENTRY vgFinish(void) VG_API_EXIT {
+		gnuVG::Context::get_current()->vgFinish();
+	}
+
 	const VGubyte * VG_API_ENTRY vgGetString(VGStringID name) VG_API_EXIT {
 		static VGubyte *vendor = (VGubyte *)strdup("Anton Persson");
 		static VGubyte *renderer = (VGubyte *)strdup("gnuVG");
@@ -1924,6 +2812,61 @@ extern "C" {
 		gnuVG::Context::get_current()->resize(pixel_width, pixel_height);
 	}
 
+	void VG_API_ENTRY gnuvgSetShaderCacheDirectory(const char *directory) VG_API_EXIT {
+		gnuVG::ProgramCache::set_directory(directory ? directory : "");
+		gnuVG::Shader::load_cached_programs();
+	}
+
+	void VG_API_ENTRY gnuvgPrecompileShaders(VGbitfield features) VG_API_EXIT {
+		using gnuVG::Shader;
+
+		// every combination of the selected features, so the
+		// internal capability bits stay out of the API
+		int modes = 0;
+		int flags = Shader::do_pretranslate | Shader::gradient_spread_mask;
+		if(features & (gnuVG_SHADER_COLOR | gnuVG_SHADER_TEXT))
+			modes |= (1 << Shader::do_flat_color) | (1 << Shader::do_vertex_color);
+		if(features & gnuVG_SHADER_TEXT)
+			flags |= Shader::do_texture_alpha;
+		if(features & gnuVG_SHADER_LINEAR_GRADIENT)
+			modes |= 1 << Shader::do_linear_gradient;
+		if(features & gnuVG_SHADER_RADIAL_GRADIENT)
+			modes |= 1 << Shader::do_radial_gradient;
+		if(features & (gnuVG_SHADER_LINEAR_GRADIENT | gnuVG_SHADER_RADIAL_GRADIENT))
+			flags |= Shader::do_two_stop_ramp;
+		if(features & (gnuVG_SHADER_PATTERN | gnuVG_SHADER_GAUSSIAN_BLUR))
+			modes |= 1 << Shader::do_pattern;
+		if(features & gnuVG_SHADER_GAUSSIAN_BLUR)
+			flags |= Shader::do_gaussian | Shader::gauss_kernel_mask;
+		if(features & gnuVG_SHADER_STROKE)
+			flags |= Shader::do_stroke_extrusion;
+		if(features & gnuVG_SHADER_NON_SCALING_STROKE)
+			flags |= Shader::do_stroke_extrusion | Shader::do_nonscaling_stroke;
+		if(features & gnuVG_SHADER_DASHED_STROKE)
+			flags |= Shader::do_stroke_extrusion | Shader::do_dash;
+		if(features & gnuVG_SHADER_ROUND_STROKE)
+			flags |= Shader::do_stroke_extrusion | Shader::do_disc;
+		if(features & gnuVG_SHADER_ANTIALIASING)
+			flags |= Shader::do_coverage;
+		if(features & gnuVG_SHADER_MASK)
+			flags |= Shader::do_mask;
+		if(features & gnuVG_SHADER_COLOR_TRANSFORM)
+			flags |= Shader::do_color_transform;
+
+		if(modes)
+			Shader::precompile(modes, flags);
+	}
+
+	void VG_API_ENTRY gnuvgSetShaderCompilerContext(
+		gnuVGBindContextCallback bind_context, void *user_data) VG_API_EXIT {
+		if(bind_context) {
+			// build what we draw with while the others compile
+			gnuVG::Shader::get_shader(gnuVG::Shader::do_generic);
+			gnuVG::ShaderCompiler::start(bind_context, user_data);
+		} else
+			gnuVG::ShaderCompiler::stop();
+	}
+
 	void VG_API_ENTRY gnuvgResetBoundingBox() {
 		gnuVG::Context::get_current()->reset_bounding_box();
 	}
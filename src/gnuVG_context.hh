@@ -28,11 +28,15 @@
 #include <map>
 #include <vector>
 #include <stack>
+#include <chrono>
 
 #include "gnuVG_math.hh"
 #include "gnuVG_object.hh"
 #include "gnuVG_paint.hh"
+#include "gnuVG_glstate.hh"
 #include "gnuVG_shader.hh"
+#include "gnuVG_streambuffer.hh"
+#include "gnuVG_colorramp.hh"
 
 #define GNUVG_MAX_SCISSORS 32
 
@@ -40,9 +44,21 @@ namespace gnuVG {
 	class Context {
 	public:
 		struct FrameBuffer {
-			GLuint framebuffer = 0, texture = 0, stencil = 0;
+			// mutable, the framebuffer and stencil are
+			// attached when first rendered to
+			mutable GLuint framebuffer = 0, texture = 0, stencil = 0;
 			VGint width = 128, height = 128;
+			VGImageFormat format = VG_sRGBA_8888; // as requested
+			mutable GLenum texture_format = GL_RGBA; // storage of the texture
+			mutable GLenum texture_type = GL_UNSIGNED_BYTE;
 			VGint subset_x = -1, subset_y = -1, subset_width = -1, subset_height = -1;
+			bool allow_linear_filter = false; // VG_IMAGE_QUALITY_BETTER was allowed
+			mutable GLint filter = GL_NEAREST; // current filter of the texture
+			mutable GLint wrap = GL_CLAMP_TO_EDGE; // current wrap mode of the texture
+			// internal and pooled buffers only, see release_idle_buffers()
+			std::chrono::steady_clock::time_point last_use;
+			// rendered to since it was created or cleared
+			mutable bool holds_data = false;
 		};
 
 		enum gnuVGFrameBuffer {
@@ -86,10 +102,14 @@ namespace gnuVG {
 		// this is the product of screen_matrix and matrix[current_matrix]
 		Matrix final_matrix[GNUVG_MATRIX_MAX];
 		bool matrix_is_dirty[GNUVG_MATRIX_MAX];
+		void force_affine_user_matrix(); // unless it is the image matrix
 		GLfloat image_matrix_data[16]; // inverted IMAGE_USER_TO_SURFACE stored in 4d GL friendly matrix
 		GLfloat conversion_matrix_data[16]; // final_matrix stored in 4d GL friendly matrix
 		GLfloat surf2fill_matrix_data[16]; // surface2fill matrix stored in 4d GL friendly matrix
 		GLfloat surf2stroke_matrix_data[16]; // surface2stroke matrix stored in 4d GL friendly matrix
+		// versions of the GL friendly matrices, see Object::new_version()
+		VGuint conversion_matrix_version = 0;
+		VGuint surf2fill_matrix_version = 0, surf2stroke_matrix_version = 0;
 		VGfloat pre_translation[2];
 
 		/* Bounding box for all paths rendered since
@@ -104,9 +124,14 @@ namespace gnuVG {
 		/* Stroke data */
 		std::vector<VGfloat> dash_pattern;
 		VGfloat stroke_width, stroke_dash_phase;
+		bool non_scaling_stroke = false;
 		bool stroke_dash_phase_reset;
 		VGfloat miter_limit;
 		VGJoinStyle join_style;
+		VGCapStyle cap_style;
+
+		/* Quality */
+		VGRenderingQuality rendering_quality = VG_RENDERING_QUALITY_BETTER;
 
 		/* Paint info */
 		Color clear_color;
@@ -128,10 +153,22 @@ namespace gnuVG {
 
 		// Temporary framebuffers
 		std::vector<FrameBuffer *> available_temporary_framebuffers;
+		VGint idle_buffer_timeout; // gnuVG_IDLE_BUFFER_TIMEOUT, in milliseconds
+
+		// the stencil is only used while rendering with scissors,
+		// which redraw it, so framebuffers of one size share it
+		struct SharedStencil {
+			GLuint renderbuffer = 0;
+			int users = 0;
+		};
+		std::map<std::pair<VGint, VGint>, SharedStencil> shared_stencils;
+
+		// new textures are attached to this to be cleared
+		GLuint clearing_framebuffer = 0;
 
 		// Scissor data
 		GLfloat scissor_vertices[GNUVG_MAX_SCISSORS * 4 * 2];
-		GLuint scissor_triangles[GNUVG_MAX_SCISSORS * 3 * 2];
+		GLushort scissor_triangles[GNUVG_MAX_SCISSORS * 3 * 2];
 		GLsizei nr_active_scissors = 0; // the number of active scissors
 		bool scissors_are_active = false;
 
@@ -145,8 +182,76 @@ namespace gnuVG {
 		const FrameBuffer* current_framebuffer = nullptr;
 		std::stack<const FrameBuffer*> framebuffer_storage;
 
+		// Shadow copy of the GL state, keep before anything owning GL objects
+		GLState gl_state;
+
+		// Streaming buffers for transient geometry
+		StreamBuffer vertex_stream, index_stream;
+
+		// The color ramps of the gradient paints in use
+		ColorRampAtlas color_ramps;
+
+		// Scratch buffers used when narrowing 32-bit meshes
+		std::vector<GLfloat> mesh_vertices;
+		std::vector<GLushort> mesh_indices;
+		std::vector<GLint> mesh_remap;
+		std::vector<GLuint> mesh_remapped;
+
+		void render_mesh_chunk();
+
+		// Batched flat color geometry, already transformed into
+		// OpenGL space and carrying its color (x, y, r, g, b, a)
+		std::vector<GLfloat> batch_vertices;
+		std::vector<Point> batch_positions; // scratch for the transformed positions
+		std::vector<GLushort> batch_indices;
+		GLenum batch_primitive = GL_TRIANGLES; // GL_TRIANGLES or GL_LINES
+		int batch_caps = -1;
+		Shader::Blending batch_blend_mode = Shader::blend_src_over;
+		GLfloat batch_color[4];
+		bool batch_flat_colors = false; // gnuVG_BATCH_FLAT_COLORS
+		bool batching = false; // the active pipeline collects into the batch
+		const GLfloat *batch_source = nullptr; // vertices loaded while batching
+		GLint batch_source_stride = 0;
+		GLsizei batch_source_count = 0;
+		bool batch_source_is_stroke = false; // batch_source has extrusions
+		bool batch_source_has_coverage = false; // batch_source is x, y, coverage
+
+		void append_to_batch(GLenum primitive,
+				     const GLushort *indices, GLsizei nr_indices);
+		void render_batch();
+		void use_scissor_stencil();
+		// the inverted paint-to-surface matrix, only computed when needed
+		void prepare_surf2paint_matrix(VGPaintMode mode);
+		void use_surf2paint_matrix();
+		// set the filter of the bound texture of fb for the rendering quality
+		void use_texture_filter(const FrameBuffer *fb);
+		// ... or to a specific filter, whatever the quality
+		void use_texture_filter(const FrameBuffer *fb, GLint filter);
+		// set the wrap mode of the bound texture of fb
+		void use_texture_wrap(const FrameBuffer *fb, GLint wrap_mode);
+		// the texture of fb, in its storage format
+		void allocate_texture(const FrameBuffer *fb);
+		// the texture of destination, its storage already chosen
+		void allocate_framebuffer(FrameBuffer* destination,
+					  VGImageFormat format,
+					  VGint w, VGint h,
+					  VGbitfield allowedQuality);
+		// attach the texture of fb to a new framebuffer
+		bool attach_framebuffer(const FrameBuffer *fb);
+		// attach a stencil shared by the framebuffers of the same size
+		void attach_stencil(const FrameBuffer *fb);
+		void release_stencil(const FrameBuffer *fb);
+		// GLES2 can't render to alpha or luminance textures,
+		// so those are moved to RGBA the first time we do
+		void make_renderable(const FrameBuffer *fb);
+
 		void render_scissors();
-		void recreate_buffers();
+		// the mask and the temporaries are created when first
+		// used, in the size of the screen buffer
+		FrameBuffer* use_internal_buffer(FrameBuffer* fb);
+		// delete the internal and pooled buffers unused for
+		// idle_buffer_timeout milliseconds
+		void release_idle_buffers();
 
 	public:
 		Context();
@@ -163,12 +268,14 @@ namespace gnuVG {
 		void resize(VGint pixel_width, VGint pixel_height);
 		void clear(VGint x, VGint y, VGint width, VGint height);
 		void trivial_render_elements(
-			GLfloat *vertices, GLuint *indices, GLsizei indices_count,
+			GLfloat *vertices, GLsizei nr_vertices,
+			GLushort *indices, GLsizei indices_count,
 			VGfloat r, VGfloat g, VGfloat b, VGfloat a);
 		void render_texture_alpha_triangle_array(const FrameBuffer *fb,
 							 const GLfloat *ver_c_2d, GLint ver_stride_2d,
 							 const GLfloat *tex_c_2d, GLint tex_stride_2d,
-							 const GLuint *indices, GLsizei nr_indices,
+							 GLsizei nr_vertices,
+							 const GLushort *indices, GLsizei nr_indices,
 							 const GLfloat *texture_matrix_3by3);
 		void trivial_fill_area(
 			VGint x, VGint y, VGint width, VGint height,
@@ -184,9 +291,23 @@ namespace gnuVG {
 		void reset_pre_translation();
 		void use_glyph_origin_as_pre_translation(VGfloat specific_glyph_origin[2]);
 		void adjust_glyph_origin(VGfloat escapement[2]);
-		void load_2dvertex_array(const GLfloat *verts, GLint stride);
+		void load_2dvertex_array(const GLfloat *verts, GLint stride,
+					 GLsizei nr_vertices);
+		void load_2dvertex_texture_array(const GLfloat *verts, GLint stride,
+						 GLsizei nr_vertices);
+		// load vertices in the SimplifiedPath::StrokeData format
+		void load_stroke_vertex_array(const GLfloat *verts, GLsizei nr_vertices);
+		// load antialiasing fringe vertices, x, y and coverage
+		void load_coverage_vertex_array(const GLfloat *verts, GLsizei nr_vertices);
 		void render_triangles(GLint first, GLsizei vertice_count);
-		void render_elements(const GLuint *indices, GLsizei nr_indices);
+		void render_elements(const GLushort *indices, GLsizei nr_indices);
+		void render_line_elements(const GLushort *indices, GLsizei nr_indices);
+		// render a mesh with 32-bit indices, split into
+		// 16-bit indexed chunks when it is too large
+		void render_mesh(const GLfloat *vertices, GLsizei nr_vertices,
+				 const GLuint *indices, GLsizei nr_indices);
+		// render everything collected in the batch
+		void flush_batch();
 		void calculate_bounding_box(Point* bounding_box);
 		void transform_bounding_box(Point* bbox, VGfloat *sp_ep);
 
@@ -197,6 +318,11 @@ namespace gnuVG {
 					VGImageFormat format,
 					VGint w, VGint h,
 					VGbitfield allowedQuality);
+		// a single channel framebuffer for masks and glyphs,
+		// sampled and written through its red channel
+		bool create_coverage_framebuffer(FrameBuffer* destination,
+						 VGint w, VGint h,
+						 VGbitfield allowedQuality);
 		void delete_framebuffer(FrameBuffer* framebuffer);
 		void render_to_framebuffer(const FrameBuffer* framebuffer);
 		const FrameBuffer* get_internal_framebuffer(gnuVGFrameBuffer selection);
@@ -229,10 +355,20 @@ namespace gnuVG {
 		// getters for stroke data
 		VGfloat get_stroke_width();
 		VGfloat get_miter_limit();
+		// the join style to use, which is always bevel unless
+		// the rendering quality is VG_RENDERING_QUALITY_BETTER
 		VGJoinStyle get_join_style();
+		VGRenderingQuality get_rendering_quality();
+		VGCapStyle get_cap_style();
 		std::vector<VGfloat> get_dash_pattern();
 		VGfloat get_dash_phase();
 		bool get_dash_phase_reset();
+		// true if the dash pattern is short enough for the shader
+		bool dash_on_gpu();
+		// true if the stroke is thin enough to be drawn as lines
+		bool stroke_is_hairline();
+		// true if edges get an antialiasing fringe
+		bool antialiasing_enabled();
 
 		void vgFlush();
 		void vgFinish();
@@ -258,6 +394,10 @@ namespace gnuVG {
 		// Map the point into the space described by the current matrix
 		Point map_point(const Point &p);
 
+		const Matrix &get_matrix(MatrixMode mode) const {
+			return matrix[mode];
+		}
+
 		/* OpenVG context setters/getters */
 		void vgSetf(VGint paramType, VGfloat value);
 		void vgSeti(VGint paramType, VGint value);
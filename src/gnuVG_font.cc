@@ -19,6 +19,7 @@
 
 #include "gnuVG_font.hh"
 #include "gnuVG_fontloader.hh"
+#include "gnuVG_config.hh"
 
 //#define __DO_GNUVG_DEBUG
 #include "gnuVG_debug.hh"
@@ -33,7 +34,7 @@ namespace gnuVG {
 
 	FontCache::FontCache(int w, int h) : SkylineBinPack(w, h, true) {
 		auto ctx = Context::get_current();
-		if(!ctx->create_framebuffer(&framebuffer, VG_sRGBA_8888, w, h, VG_IMAGE_QUALITY_BETTER))
+		if(!ctx->create_coverage_framebuffer(&framebuffer, w, h, VG_IMAGE_QUALITY_BETTER))
 			throw FailedToCreateFontCacheException();
 
 		ctx->save_current_framebuffer();
@@ -456,7 +457,7 @@ namespace gnuVG {
 	static VGfloat cord_cache_buffer[] = {0.0, 0.0};
 	static std::vector<VGfloat> vrtc_cache_buffer; // vertices
 	static std::vector<VGfloat> txtc_cache_buffer; // texture coordinates
-	static std::vector<VGuint>  indc_cache_buffer; // indices
+	static std::vector<GLushort> indc_cache_buffer; // indices
 
 	static void reset_cache_buffer() {
 		cord_cache_buffer[0] = 0.0;
@@ -525,11 +526,24 @@ namespace gnuVG {
 			&(fc->framebuffer),
 			vrtc_cache_buffer.data(), 0,
 			txtc_cache_buffer.data(), 0,
+			vrtc_cache_buffer.size() / 2,
 			indc_cache_buffer.data(), indc_cache_buffer.size(),
 			fc->get_texture_matrix()
 			);
 	}
 
+	// render what we have so far if another glyph quad would
+	// overflow the 16-bit indices
+	static void make_room_in_cache_buffer(Context *ctx, const FontCache *fc) {
+		if(vrtc_cache_buffer.size() / 2 + 4 <= GNUVG_MAX_INDEXED_VERTICES)
+			return;
+
+		render_cache_buffer(ctx, fc);
+		vrtc_cache_buffer.clear();
+		txtc_cache_buffer.clear();
+		indc_cache_buffer.clear();
+	}
+
 	void Font::vgDrawGlyphs(VGint glyphCount,
 				const VGuint *glyphIndices,
 				const VGfloat *adjustments_x,
@@ -566,6 +580,7 @@ namespace gnuVG {
 				if(adjustments_y) adjustment[1] += adjustments_y[k];
 
 				if(fc->lookup(glyphIndex, cached_result)) {
+					make_room_in_cache_buffer(ctx, fc);
 					push_to_cache_buffer(fc_scale, cached_result);
 					for(auto k = 0; k < 2; ++k) {
 						cord_cache_buffer[k] += adjustment[k];
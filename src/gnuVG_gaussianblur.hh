@@ -35,12 +35,10 @@
 // Created by: filip.strugar@intel.com
 //--------------------------------------------------------------------------------------
 //
-// - function "GenerateGaussShaderKernelWeightsAndOffsets" will generate shader
-//      constants for high performance Gaussian blur filter implementation (separable,
-//      using hardware linear filter when sampling to get two samples at a time)
-//
-// - function "GenerateGaussFunctionCode" will generate GLSL code using the above
-//      constants; for HLSL replace vec2/vec3 with float2/float3, etc, "should work"
+// - function "GetSeparableGaussWeightsAndOffsets" will generate the weights and
+//      offsets for high performance Gaussian blur filter implementation (separable,
+//      using hardware linear filter when sampling to get two samples at a time),
+//      gnuVG passes them to the shader as uniforms
 //
 // - Acceptable kernel sizes are of 4*n-1 (3, 7, 11, 15, ...)
 //
@@ -53,22 +51,12 @@
 
 #include <assert.h>
 #include <vector>
-#include <string>
-#include <stdarg.h>
 #include <math.h>
 
 #include "gnuVG_error.hh"
 
 namespace gnuVG {
 
-	inline std::string stringFormatA( const char * fmt, ... ) {
-		char buff[4096];
-		va_list args;
-		va_start(args, fmt);
-		(void) vsnprintf( buff, sizeof(buff) - 1, fmt, args); // C4996
-		return std::string( buff );
-	}
-
 	inline std::vector<double> GenerateSeparableGaussKernel( double sigma, int kernelSize ) {
 		int halfKernelSize = kernelSize/2;
 
@@ -121,8 +109,13 @@ namespace gnuVG {
 		return std::vector<float>();
 	}
 
-	inline std::string GenerateGaussShaderKernelWeightsAndOffsets( int kernelSize, bool forPreprocessorDefine = false, bool workaroundForNoCLikeArrayInitialization = false ) {
-		// Gauss filter kernel & offset creation
+	/* The kernel as pairs of texels, read with one linear filtered
+	 * sample each, to both sides of the centre. The centre texel is
+	 * split between the first samples to each side.
+	 */
+	inline void GetSeparableGaussWeightsAndOffsets( int kernelSize,
+							std::vector<float> &weights,
+							std::vector<float> &offsets ) {
 		std::vector<float> inputKernel = GetAppropriateSeparableGauss(kernelSize);
 
 		std::vector<float> oneSideInputs;
@@ -135,91 +128,22 @@ namespace gnuVG {
 
 		int numSamples = oneSideInputs.size()/2;
 
-		std::vector<float> weights;
-
+		weights.clear();
 		for( int i = 0; i < numSamples; i++ ) {
 			float sum = oneSideInputs[i*2+0] + oneSideInputs[i*2+1];
 			weights.push_back(sum);
 		}
 
-		std::vector<float> offsets;
-
+		offsets.clear();
 		for( int i = 0; i < numSamples; i++ ) {
 			offsets.push_back( i*2.0f + oneSideInputs[i*2+1] / weights[i] );
 		}
 
-		std::string indent = "    ";
-
-		std::stringstream fshad;
-
-		std::string eol = "\n";
-		fshad << indent + "//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////;" << eol;
-		fshad << indent << "// Kernel diameter " << kernelSize << eol;
-		fshad << indent << "//" << eol;
-		fshad << indent << "const int stepCount = " << numSamples << ";" << eol;
-
-		if( !workaroundForNoCLikeArrayInitialization ) {
-			if( !forPreprocessorDefine) fshad << indent << "//" << eol;
-			fshad << indent << "const float gWeights[stepCount] ={" << eol;
-			for( int i = 0; i < numSamples; i++ )
-				fshad << indent << "   " << weights[i]
-				      << ((i!=(numSamples-1))?(","):("")) << eol;
-			fshad << indent << "};" << eol
-			      << indent << "const float gOffsets[stepCount] ={" << eol;
-			for( int i = 0; i < numSamples; i++ )
-				fshad << indent << "   " << offsets[i]
-				      << ((i!=(numSamples-1))?(","):("")) << eol;
-			fshad << indent << "};" << eol;
-		} else {
-			if( !forPreprocessorDefine) fshad << indent << "//" << eol;
-
-			fshad << indent << "float gWeights[stepCount];" << eol;
-
-			for( int i = 0; i < numSamples; i++ )
-				fshad << indent << " gWeights[" << i << "] = " << weights[i] << ";" << eol;
-			fshad << eol;
-			fshad << indent << "float gOffsets[stepCount];" << eol;
-
-			for( int i = 0; i < numSamples; i++ )
-				fshad << indent << " gOffsets[" << i << "] = " << offsets[i] << ";" << eol;
-			fshad << eol;
+		// sizes other than 4*n-1 leave one texel, which gets its own sample
+		if( oneSideInputs.size() & 1 ) {
+			weights.push_back( oneSideInputs.back() );
+			offsets.push_back( (float)(oneSideInputs.size() - 1) );
 		}
-
-		fshad << indent << "//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////;" << eol;
-
-		return fshad.str();
-	}
-
-	inline std::string GenerateGaussFunctionCode( int kernelSize, bool workaroundForNoCLikeArrayInitialization = false ) {
-		std::string shaderCode;
-
-		// force odd size
-		kernelSize |= 0x1;
-
-		std::string eol = "\n";
-
-		shaderCode += eol;
-		shaderCode += "// automatically generated by GenerateGaussFunctionCode in gnuVG_gaussianblur.hh                                                                                            " + eol;
-		shaderCode += "vec4 GaussianBlur( sampler2D tex0, vec2 centreUV, vec2 halfPixelOffset, vec2 pixelOffset )                                                                           " + eol;
-		shaderCode += "{                                                                                                                                                                    " + eol;
-		shaderCode += "    vec4 colOut = vec4( 0, 0, 0, 0 );                                                                                                                                   " + eol;
-		shaderCode += "                                                                                                                                                                     " + eol;
-		shaderCode += GenerateGaussShaderKernelWeightsAndOffsets( kernelSize, false, workaroundForNoCLikeArrayInitialization );
-		shaderCode += "                                                                                                                                                                     " + eol;
-		shaderCode += "    for( int i = 0; i < stepCount; i++ )                                                                                                                             " + eol;
-		shaderCode += "    {                                                                                                                                                                " + eol;
-		shaderCode += "        vec2 texCoordOffset = gOffsets[i] * pixelOffset;                                                                                                           " + eol;
-		shaderCode += "        vec4 c1 = texture2D( tex0, centreUV + texCoordOffset );" + eol;
-		shaderCode += "        vec4 c2 = texture2D( tex0, centreUV - texCoordOffset );" + eol;
-		shaderCode += "        vec4 col = c1 + c2;" + eol;
-		shaderCode += "        colOut += gWeights[i] * col;                                                                                                                               " + eol;
-		shaderCode += "    }                                                                                                                                                                " + eol;
-		shaderCode += "                                                                                                                                                                     " + eol;
-		shaderCode += "    return colOut;                                                                                                                                                   " + eol;
-		shaderCode += "}                                                                                                                                                                    " + eol;
-		shaderCode += eol;
-
-		return shaderCode;
 	}
 
 };
@@ -0,0 +1,300 @@
+/*
+ * gnuVG - a free Vector Graphics library
+ * Copyright (C) 2016 by Anton Persson
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "gnuVG_glstate.hh"
+
+//#define __DO_GNUVG_DEBUG
+#include "gnuVG_debug.hh"
+
+#define ENABLE_GNUVG_PROFILER
+#include <VG/gnuVG_profiler.hh>
+
+namespace gnuVG {
+
+	GLState *GLState::current = nullptr;
+
+	GLState::GLState() {
+		invalidate();
+	}
+
+	GLState *GLState::get_current() {
+		return current;
+	}
+
+	void GLState::set_current(GLState *state) {
+		current = state;
+	}
+
+	void GLState::invalidate() {
+		program_known = false;
+
+		blend = flag_unknown;
+		stencil_test = flag_unknown;
+		color_writes = flag_unknown;
+
+		blend_func_known = false;
+		stencil_func_known = false;
+		stencil_op_known = false;
+		stencil_mask_known = false;
+
+		active_unit_known = false;
+		for(auto k = 0; k < max_texture_units; k++)
+			texture_known[k] = false;
+
+		array_buffer_known = false;
+		element_buffer_known = false;
+
+		for(auto &attrib : attribs) {
+			attrib.enabled = flag_unknown;
+			attrib.pointer_known = false;
+			attrib.constant_known = false;
+		}
+	}
+
+	// the number of GL calls we actually let through
+	void GLState::count_change() {
+		ADD_GNUVG_PROFILER_COUNTER(GL_state_changes, 1);
+	}
+
+	void GLState::set_flag(Flag &flag, GLenum cap, bool enabled) {
+		auto wanted = enabled ? flag_on : flag_off;
+		if(flag == wanted) return;
+
+		count_change();
+		if(enabled)
+			glEnable(cap);
+		else
+			glDisable(cap);
+		flag = wanted;
+	}
+
+	void GLState::use_program(GLuint _program) {
+		if(program_known && program == _program) return;
+
+		count_change();
+		glUseProgram(_program);
+		program = _program;
+		program_known = true;
+	}
+
+	void GLState::set_blend(bool enabled) {
+		set_flag(blend, GL_BLEND, enabled);
+	}
+
+	void GLState::blend_func(GLenum src_rgb, GLenum dst_rgb,
+				 GLenum src_alpha, GLenum dst_alpha) {
+		if(blend_func_known &&
+		   blend_src_rgb == src_rgb && blend_dst_rgb == dst_rgb &&
+		   blend_src_alpha == src_alpha && blend_dst_alpha == dst_alpha)
+			return;
+
+		count_change();
+		glBlendFuncSeparate(src_rgb, dst_rgb, src_alpha, dst_alpha);
+		blend_src_rgb = src_rgb;
+		blend_dst_rgb = dst_rgb;
+		blend_src_alpha = src_alpha;
+		blend_dst_alpha = dst_alpha;
+		blend_func_known = true;
+	}
+
+	void GLState::set_stencil_test(bool enabled) {
+		set_flag(stencil_test, GL_STENCIL_TEST, enabled);
+	}
+
+	void GLState::stencil_func(GLenum func, GLint ref, GLuint mask) {
+		if(stencil_func_known &&
+		   stencil_func_func == func &&
+		   stencil_func_ref == ref &&
+		   stencil_func_mask == mask)
+			return;
+
+		count_change();
+		glStencilFunc(func, ref, mask);
+		stencil_func_func = func;
+		stencil_func_ref = ref;
+		stencil_func_mask = mask;
+		stencil_func_known = true;
+	}
+
+	void GLState::stencil_op(GLenum sfail, GLenum dpfail, GLenum dppass) {
+		if(stencil_op_known &&
+		   stencil_op_sfail == sfail &&
+		   stencil_op_dpfail == dpfail &&
+		   stencil_op_dppass == dppass)
+			return;
+
+		count_change();
+		glStencilOp(sfail, dpfail, dppass);
+		stencil_op_sfail = sfail;
+		stencil_op_dpfail = dpfail;
+		stencil_op_dppass = dppass;
+		stencil_op_known = true;
+	}
+
+	void GLState::stencil_mask(GLuint mask) {
+		if(stencil_mask_known && stencil_write_mask == mask) return;
+
+		count_change();
+		glStencilMask(mask);
+		stencil_write_mask = mask;
+		stencil_mask_known = true;
+	}
+
+	void GLState::color_mask(bool enabled) {
+		auto wanted = enabled ? flag_on : flag_off;
+		if(color_writes == wanted) return;
+
+		count_change();
+		auto m = enabled ? GL_TRUE : GL_FALSE;
+		glColorMask(m, m, m, m);
+		color_writes = wanted;
+	}
+
+	void GLState::bind_texture(GLuint unit, GLuint _texture) {
+		if(unit >= max_texture_units) {
+			GNUVG_ERROR("GLState::bind_texture() - unit %d out of range.\n", unit);
+			return;
+		}
+
+		if(!(active_unit_known && active_unit == unit)) {
+			count_change();
+			glActiveTexture(GL_TEXTURE0 + unit);
+			active_unit = unit;
+			active_unit_known = true;
+		}
+
+		if(texture_known[unit] && texture[unit] == _texture) return;
+
+		count_change();
+		glBindTexture(GL_TEXTURE_2D, _texture);
+		texture[unit] = _texture;
+		texture_known[unit] = true;
+	}
+
+	void GLState::forget_texture(GLuint _texture) {
+		// GL reverts bindings of a deleted texture to zero,
+		// and a new texture could reuse the name
+		for(auto k = 0; k < max_texture_units; k++)
+			if(texture_known[k] && texture[k] == _texture)
+				texture[k] = 0;
+	}
+
+	void GLState::bind_buffer(GLenum target, GLuint buffer) {
+		bool *known;
+		GLuint *bound;
+
+		switch(target) {
+		case GL_ARRAY_BUFFER:
+			known = &array_buffer_known;
+			bound = &array_buffer;
+			break;
+		case GL_ELEMENT_ARRAY_BUFFER:
+			known = &element_buffer_known;
+			bound = &element_buffer;
+			break;
+		default:
+			glBindBuffer(target, buffer);
+			return;
+		}
+
+		if(*known && *bound == buffer) return;
+
+		count_change();
+		glBindBuffer(target, buffer);
+		*bound = buffer;
+		*known = true;
+	}
+
+	void GLState::forget_buffer(GLuint buffer) {
+		if(array_buffer_known && array_buffer == buffer)
+			array_buffer = 0;
+		if(element_buffer_known && element_buffer == buffer)
+			element_buffer = 0;
+		for(auto &attrib : attribs)
+			if(attrib.pointer_known && attrib.buffer == buffer)
+				attrib.pointer_known = false;
+	}
+
+	void GLState::vertex_attrib_pointer(GLint index, GLint size,
+					    GLsizei stride, const GLvoid *pointer) {
+		if(index < 0) return;
+		if(index >= max_vertex_attribs) {
+			glVertexAttribPointer(index, size, GL_FLOAT, GL_FALSE, stride, pointer);
+			glEnableVertexAttribArray(index);
+			return;
+		}
+
+		auto &attrib = attribs[index];
+
+		// the pointer is relative to the array buffer bound at the time
+		GLuint buffer = array_buffer_known ? array_buffer : 0;
+		if(!(array_buffer_known &&
+		     attrib.pointer_known &&
+		     attrib.buffer == buffer &&
+		     attrib.size == size &&
+		     attrib.stride == stride &&
+		     attrib.pointer == pointer)) {
+			count_change();
+			glVertexAttribPointer(index, size, GL_FLOAT, GL_FALSE, stride, pointer);
+			attrib.pointer_known = array_buffer_known;
+			attrib.buffer = buffer;
+			attrib.size = size;
+			attrib.stride = stride;
+			attrib.pointer = pointer;
+		}
+
+		if(attrib.enabled != flag_on) {
+			count_change();
+			glEnableVertexAttribArray(index);
+			attrib.enabled = flag_on;
+		}
+	}
+
+	void GLState::disable_vertex_attrib_array(GLint index) {
+		if(index < 0) return;
+		if(index >= max_vertex_attribs) {
+			glDisableVertexAttribArray(index);
+			return;
+		}
+
+		auto &attrib = attribs[index];
+		if(attrib.enabled == flag_off) return;
+
+		count_change();
+		glDisableVertexAttribArray(index);
+		attrib.enabled = flag_off;
+	}
+
+	void GLState::vertex_attrib_1f(GLint index, GLfloat value) {
+		if(index < 0) return;
+		if(index >= max_vertex_attribs) {
+			glVertexAttrib1f(index, value);
+			return;
+		}
+
+		auto &attrib = attribs[index];
+		if(attrib.constant_known && attrib.constant == value) return;
+
+		count_change();
+		glVertexAttrib1f(index, value);
+		attrib.constant = value;
+		attrib.constant_known = true;
+	}
+
+};
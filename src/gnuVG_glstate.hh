@@ -0,0 +1,128 @@
+/*
+ * gnuVG - a free Vector Graphics library
+ * Copyright (C) 2016 by Anton Persson
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+
+namespace gnuVG {
+
+	/* Shadow copy of the GL state that gnuVG changes. Each setter
+	 * only calls into GL when the value actually differs from what
+	 * we know is set. All state changes must go through the current
+	 * GLState, or it must be invalidated after the fact.
+	 */
+	class GLState {
+	public:
+		enum {
+			max_texture_units = 5,
+			max_vertex_attribs = 16
+		};
+
+		GLState();
+
+		static GLState *get_current();
+		static void set_current(GLState *state);
+
+		// forget everything, use when someone else touched the GL state
+		void invalidate();
+
+		void use_program(GLuint program);
+
+		void set_blend(bool enabled);
+		void blend_func(GLenum src_rgb, GLenum dst_rgb,
+				GLenum src_alpha, GLenum dst_alpha);
+
+		void set_stencil_test(bool enabled);
+		void stencil_func(GLenum func, GLint ref, GLuint mask);
+		void stencil_op(GLenum sfail, GLenum dpfail, GLenum dppass);
+		void stencil_mask(GLuint mask);
+		void color_mask(bool enabled);
+
+		// unit 0 is GL_TEXTURE0 and so on, the texture
+		// is also left bound on the active unit for updates
+		void bind_texture(GLuint unit, GLuint texture);
+		// must be called when a texture is deleted
+		void forget_texture(GLuint texture);
+
+		void bind_buffer(GLenum target, GLuint buffer);
+		// must be called when a buffer is deleted
+		void forget_buffer(GLuint buffer);
+
+		// float array sourced from the bound GL_ARRAY_BUFFER
+		void vertex_attrib_pointer(GLint index, GLint size,
+					   GLsizei stride, const GLvoid *pointer);
+		void disable_vertex_attrib_array(GLint index);
+		void vertex_attrib_1f(GLint index, GLfloat value);
+
+	private:
+		static GLState *current;
+
+		// tri-state flags, unknown after invalidate()
+		enum Flag {
+			flag_unknown = -1,
+			flag_off = 0,
+			flag_on = 1
+		};
+
+		struct VertexAttrib {
+			Flag enabled;
+			bool pointer_known, constant_known;
+			GLuint buffer;
+			GLint size;
+			GLsizei stride;
+			const GLvoid *pointer;
+			GLfloat constant;
+		};
+
+		bool program_known;
+		GLuint program;
+
+		Flag blend, stencil_test, color_writes;
+
+		bool blend_func_known;
+		GLenum blend_src_rgb, blend_dst_rgb, blend_src_alpha, blend_dst_alpha;
+
+		bool stencil_func_known;
+		GLenum stencil_func_func;
+		GLint stencil_func_ref;
+		GLuint stencil_func_mask;
+
+		bool stencil_op_known;
+		GLenum stencil_op_sfail, stencil_op_dpfail, stencil_op_dppass;
+
+		bool stencil_mask_known;
+		GLuint stencil_write_mask;
+
+		bool active_unit_known;
+		GLuint active_unit;
+		bool texture_known[max_texture_units];
+		GLuint texture[max_texture_units];
+
+		bool array_buffer_known, element_buffer_known;
+		GLuint array_buffer, element_buffer;
+
+		VertexAttrib attribs[max_vertex_attribs];
+
+		static void count_change();
+		static void set_flag(Flag &flag, GLenum cap, bool enabled);
+	};
+
+};
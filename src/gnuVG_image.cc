@@ -148,7 +148,7 @@ namespace gnuVG {
 	VGint Image::vgGetParameteri(VGint paramType) {
 		switch(paramType) {
 		case VG_IMAGE_FORMAT:
-			return VG_sRGBA_8888;
+			return framebuffer.format;
 		case VG_IMAGE_WIDTH:
 			return framebuffer.width;
 		case VG_IMAGE_HEIGHT:
@@ -24,14 +24,10 @@
 //#define __DO_GNUVG_DEBUG
 #include "gnuVG_debug.hh"
 
-#define MASK_R_CHANNEL_VALUE 0.0f
-#define MASK_G_CHANNEL_VALUE 0.0f
-#define MASK_B_CHANNEL_VALUE 0.0f
-
 namespace gnuVG {
 	MaskLayer::MaskLayer(Context* ctx, VGint width, VGint height) {
-		if(ctx->create_framebuffer(
-			   &framebuffer, VG_sRGBA_8888,
+		if(!ctx->create_coverage_framebuffer(
+			   &framebuffer,
 			   width, height,
 			   VG_IMAGE_QUALITY_BETTER))
 			throw FailedToCreateMaskLayerException();
@@ -50,10 +46,7 @@ namespace gnuVG {
 			ctx->save_current_framebuffer();
 			ctx->render_to_framebuffer(&framebuffer);
 			ctx->trivial_fill_area(x, y, width, height,
-					       MASK_R_CHANNEL_VALUE,
-					       MASK_G_CHANNEL_VALUE,
-					       MASK_B_CHANNEL_VALUE,
-					       value);
+					       value, value, value, value);
 			ctx->restore_current_framebuffer();
 		}
 	}
@@ -63,7 +56,8 @@ namespace gnuVG {
 				   VGint width, VGint height) {
 		auto ctx = Context::get_current();
 		if(ctx) {
-			auto fbuf = ctx->get_internal_framebuffer(Context::GNUVG_CURRENT_FRAMEBUFFER);
+			// the layer takes a copy of the surface mask
+			auto fbuf = ctx->get_internal_framebuffer(Context::GNUVG_MASK_BUFFER);
 			ctx->copy_framebuffer_to_framebuffer(
 				fbuf, &framebuffer,
 				dx, dy, sx, sy, width, height);
@@ -204,13 +198,23 @@ extern "C" {
 			VGfloat value = operation == VG_CLEAR_MASK ? 0.0f : 1.0f;
 			render_direct_helper(ctx,
 					     [ctx, x, y, width, height, value]() {
+						     // replace, clearing can't blend
+						     auto old_blend = vgGeti(VG_BLEND_MODE);
+						     vgSeti(VG_BLEND_MODE, VG_BLEND_SRC);
 						     ctx->trivial_fill_area(x, y, width, height,
-									    MASK_R_CHANNEL_VALUE,
-									    MASK_G_CHANNEL_VALUE,
-									    MASK_B_CHANNEL_VALUE,
-									    value);
+									    value, value, value, value);
+						     vgSeti(VG_BLEND_MODE, old_blend);
 					     }
 				);
+
+			// a mask cleared all over has nothing to keep
+			auto fb_mask = ctx->get_internal_framebuffer(Context::GNUVG_MASK_BUFFER);
+			if(operation == VG_CLEAR_MASK &&
+			   vgGeti(VG_SCISSORING) == VG_FALSE &&
+			   x <= 0 && y <= 0 &&
+			   x + width >= fb_mask->width &&
+			   y + height >= fb_mask->height)
+				fb_mask->holds_data = false;
 		} else {
 			GNUVG_ERROR("vgMask() only supports VG_CLEAR_MASK and VG_FILL_MASK.\n");
 			ctx->set_error(VG_BAD_HANDLE_ERROR);
@@ -243,10 +247,8 @@ extern "C" {
 					      mpaint = vgCreatePaint();
 
 				      if(mpaint) {
-					      VGfloat rgba[] = {MASK_R_CHANNEL_VALUE,
-								MASK_G_CHANNEL_VALUE,
-								MASK_B_CHANNEL_VALUE,
-								1.0f};
+					      // the mask is read from the red channel
+					      VGfloat rgba[] = {1.0f, 1.0f, 1.0f, 1.0f};
 
 					      // remeber old settings for mask/scissors
 					      VGint do_mask, do_scissors;
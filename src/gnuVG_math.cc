@@ -48,6 +48,13 @@
 
 #include "gnuVG_math.hh"
 
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define GNUVG_USE_NEON
+#endif
+
 static inline bool edgeEdgeTest(const gnuVG::Point& v0Delta,
 				const gnuVG::Point& v0,
 				const gnuVG::Point& u0,
@@ -168,8 +175,65 @@ namespace gnuVG {
 	}
 
 	Point Matrix::map_point(const Point &p) {
-		return Point(p.x * a + p.y * d + g,
-			     p.x * b + p.y * e + h);
+		if(isAffine())
+			return Point(p.x * a + p.y * d + g,
+				     p.x * b + p.y * e + h);
+
+		auto w = 1.0f / (p.x * c + p.y * f + i);
+		return Point((p.x * a + p.y * d + g) * w,
+			     (p.x * b + p.y * e + h) * w);
+	}
+
+	static_assert(sizeof(Point) == 2 * sizeof(VGfloat),
+		      "map_points() treats Point arrays as packed x, y floats");
+
+	void Matrix::map_points(const Point *src, Point *dst, size_t n) const {
+		if(n == 0) return;
+
+		const VGfloat *s = src[0].c;
+		VGfloat *o = dst[0].c;
+		size_t k = 0;
+
+		if(!isAffine()) {
+			for(; k < n; k++, s += 2, o += 2) {
+				auto x = s[0], y = s[1];
+				auto w = 1.0f / (x * c + y * f + i);
+				o[0] = (x * a + y * d + g) * w;
+				o[1] = (x * b + y * e + h) * w;
+			}
+			return;
+		}
+
+#if defined(__SSE__)
+		// two points per register - x0 y0 x1 y1
+		auto col_x = _mm_setr_ps(a, b, a, b);
+		auto col_y = _mm_setr_ps(d, e, d, e);
+		auto col_t = _mm_setr_ps(g, h, g, h);
+		for(; k + 2 <= n; k += 2, s += 4, o += 4) {
+			auto p = _mm_loadu_ps(s);
+			auto xs = _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 0, 0));
+			auto ys = _mm_shuffle_ps(p, p, _MM_SHUFFLE(3, 3, 1, 1));
+			auto r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(xs, col_x),
+						       _mm_mul_ps(ys, col_y)),
+					    col_t);
+			_mm_storeu_ps(o, r);
+		}
+#elif defined(GNUVG_USE_NEON)
+		// four points at a time, split into x and y registers
+		for(; k + 4 <= n; k += 4, s += 8, o += 8) {
+			auto p = vld2q_f32(s);
+			float32x4x2_t r;
+			r.val[0] = vmlaq_n_f32(vmlaq_n_f32(vdupq_n_f32(g), p.val[0], a), p.val[1], d);
+			r.val[1] = vmlaq_n_f32(vmlaq_n_f32(vdupq_n_f32(h), p.val[0], b), p.val[1], e);
+			vst2q_f32(o, r);
+		}
+#endif
+
+		for(; k < n; k++, s += 2, o += 2) {
+			auto x = s[0], y = s[1];
+			o[0] = x * a + y * d + g;
+			o[1] = x * b + y * e + h;
+		}
 	}
 
 	bool Triangle::contains_point(const Point& point) {
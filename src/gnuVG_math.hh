@@ -243,7 +243,27 @@ namespace gnuVG {
 		}
 
 		bool invert() {
-			bool affine = isAffine();
+			if(isAffine()) {
+				// only the 2x2 part and the translation matter
+				VGfloat det = a * e - b * d;
+				if(det == 0.0f) return false;
+				det = 1.0f / det;
+
+				Matrix t;
+				t.a = det * e;
+				t.d = -det * d;
+				t.b = -det * b;
+				t.e = det * a;
+				t.g = -(t.a * g + t.d * h);
+				t.h = -(t.b * g + t.e * h);
+				t.c = 0.0f;
+				t.f = 0.0f;
+				t.i = 1.0f;
+				set_to(t);
+
+				return true;
+			}
+
 			VGfloat det00 = e * i - f * h;
 			VGfloat det01 = c * h - b * i;
 			VGfloat det02 = b * f - c * e;
@@ -262,18 +282,18 @@ namespace gnuVG {
 			t.g = det * (d * h - e * g);
 			t.h = det * (b * g - a * h);
 			t.i = det * (a * e - b * d);
-			if(affine) {
-				//affine matrix stays affine
-				t.c = 0.0f;
-				t.f = 0.0f;
-				t.i = 1.0f;
-			}
 			set_to(t);
 
 			return true;
 		}
 
+		// affine matrices skip the perspective divide
 		Point map_point(const Point &p);
+
+		/* Map n points from src to dst, which may be the same
+		 * array. Affine matrices use a SIMD kernel when available.
+		 */
+		void map_points(const Point *src, Point *dst, size_t n) const;
 	};
 
 	class Triangle {
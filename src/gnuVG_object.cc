@@ -32,6 +32,13 @@ namespace gnuVG {
 	static IDAllocator<VGHandle> idalloc(1);
 
 	Object::Object() {}
+
+	VGuint Object::new_version() {
+		static VGuint last_version = 0;
+		if(++last_version == 0) // skip 0 on wrap around
+			++last_version;
+		return last_version;
+	}
 	Object::~Object() {
 		idalloc.free_id(obj_handle);
 	}
@@ -72,6 +72,9 @@ namespace gnuVG {
 
 		static void dereference(VGHandle handle);
 
+		// unique across everything that hands out versions, never 0
+		static VGuint new_version();
+
 		template<typename T>
 		static std::shared_ptr<T> get(VGHandle handle) {
 			auto obj = std::static_pointer_cast<T>(get_by_handle(handle));
@@ -32,6 +32,7 @@ namespace gnuVG {
 		color.g = ((rgba >> 16) & 0xff)/255.0f;
 		color.b = ((rgba >>  8) & 0xff)/255.0f;
 		color.a = ( rgba        & 0xff)/255.0f;
+		changed();
 	}
 
 	VGuint Paint::vgGetColor() {
@@ -74,6 +75,7 @@ namespace gnuVG {
 			case VG_PAINT_TYPE_RADIAL_GRADIENT:
 			case VG_PAINT_TYPE_PATTERN:
 				ptype = (VGPaintType)value;
+				changed();
 				return;
 			}
 			break;
@@ -84,12 +86,14 @@ namespace gnuVG {
 			case VG_COLOR_RAMP_SPREAD_REPEAT:
 			case VG_COLOR_RAMP_SPREAD_REFLECT:
 				spread_mode = (VGColorRampSpreadMode)value;
+				changed();
 				return;
 			}
 			break;
 
 		case VG_PAINT_COLOR_RAMP_PREMULTIPLIED:
 			premultiplied = (VGboolean)value == VG_TRUE ? true : false;
+			changed();
 			return;
 
 		case VG_PAINT_PATTERN_TILING_MODE:
@@ -99,6 +103,7 @@ namespace gnuVG {
 			case VG_TILE_REPEAT:
 			case VG_TILE_REFLECT:
 				tiling_mode = (VGTilingMode)value;
+				changed();
 				return;
 			}
 			break;
@@ -124,6 +129,7 @@ namespace gnuVG {
 				for(int k = 0; k < 4; k++) {
 					color.c[k] = values[k];
 				}
+				changed();
 			} else {
 				gnuVG::Context::get_current()->set_error(VG_ILLEGAL_ARGUMENT_ERROR);
 			}
@@ -158,6 +164,8 @@ namespace gnuVG {
 			} else {
 				max_stops = 0;
 			}
+			ramp_version = new_version();
+			changed();
 			return;
 
 		case VG_PAINT_LINEAR_GRADIENT:
@@ -176,6 +184,7 @@ namespace gnuVG {
 				/* calculate the normal */
 				gradient_parameters[2] = -(dirv_y) / gradient_parameters[4];
 				gradient_parameters[3] = dirv_x / gradient_parameters[4];
+				changed();
 				return;
 			}
 			break;
@@ -202,6 +211,7 @@ namespace gnuVG {
 						 +
 						 gradient_parameters[3] * gradient_parameters[3]
 							));
+				changed();
 				return;
 			}
 			break;
@@ -340,6 +350,7 @@ namespace gnuVG {
 
 	void Paint::vgPaintPattern(std::shared_ptr<Image> image) {
 		pattern = image;
+		changed();
 	}
 }
 
@@ -43,26 +43,24 @@ namespace gnuVG {
 
 	class Paint : public Object {
 	public:
-		VGPaintType ptype = VG_PAINT_TYPE_COLOR;
+		VGPaintType get_paint_type() const { return ptype; }
+		const Color &get_color() const { return color; }
+		const VGfloat *get_gradient_parameters() const { return gradient_parameters; }
 
-		Color color;
+		int get_nr_color_ramp_stops() const { return max_stops; }
+		const VGfloat *get_color_ramp_stop_offsets() const { return color_ramp_stop_offset; }
+		const VGfloat *get_color_ramp_stop_invfactors() const { return color_ramp_stop_invfactor; }
+		const VGfloat *get_color_ramp_stop_colors() const { return color_ramp_stop_color; }
+		VGColorRampSpreadMode get_spread_mode() const { return spread_mode; }
 
-		// Gradient parameters - depending on type
-		//   linear: x0, y0, normal.x, normal.y, length
-		//   radial: cx, cy, fx - cx, fy - cy, r ^ 2, 1 / (r^2 − (fx'^2 + fy'^2))
-		VGfloat gradient_parameters[6];
+		// a ramp the shaders can mix directly from two colors
+		bool is_two_stop_ramp() const {
+			return max_stops == 2 &&
+				color_ramp_stop_offset[1] > color_ramp_stop_offset[0];
+		}
 
-		// Each stop is 6 values - (offset), (invfactor) and (R, G, B, A)
-		VGfloat color_ramp_stop_offset[GNUVG_MAX_COLOR_RAMP_STOPS];
-		VGfloat color_ramp_stop_invfactor[GNUVG_MAX_COLOR_RAMP_STOPS];
-		VGfloat color_ramp_stop_color[GNUVG_MAX_COLOR_RAMP_STOPS * 4];
-		VGColorRampSpreadMode spread_mode = VG_COLOR_RAMP_SPREAD_PAD;
-		int max_stops = 0;
-		bool premultiplied;
-
-		// pattern image
-		VGTilingMode tiling_mode = VG_TILE_FILL;
-		std::shared_ptr<Image> pattern;
+		VGTilingMode get_tiling_mode() const { return tiling_mode; }
+		const std::shared_ptr<Image> &get_pattern() const { return pattern; }
 
 		/* OpenVG equivalent API - Paint Manipulation */
 		void vgSetColor(VGuint rgba);
@@ -83,6 +81,39 @@ namespace gnuVG {
 		virtual void vgGetParameteriv(VGint paramType, VGint count, VGint *values);
 
 		virtual void vgPaintPattern(std::shared_ptr<Image> pattern);
+
+		// changes every time a parameter is set
+		VGuint get_version() const { return version; }
+		// changes only when the color ramp stops are set
+		VGuint get_ramp_version() const { return ramp_version; }
+
+	private:
+		// set only through the parameter API, which bumps the versions
+		VGPaintType ptype = VG_PAINT_TYPE_COLOR;
+
+		Color color;
+
+		// Gradient parameters - depending on type
+		//   linear: x0, y0, normal.x, normal.y, length
+		//   radial: cx, cy, fx - cx, fy - cy, r ^ 2, 1 / (r^2 − (fx'^2 + fy'^2))
+		VGfloat gradient_parameters[6];
+
+		// Each stop is 6 values - (offset), (invfactor) and (R, G, B, A)
+		VGfloat color_ramp_stop_offset[GNUVG_MAX_COLOR_RAMP_STOPS];
+		VGfloat color_ramp_stop_invfactor[GNUVG_MAX_COLOR_RAMP_STOPS];
+		VGfloat color_ramp_stop_color[GNUVG_MAX_COLOR_RAMP_STOPS * 4];
+		VGColorRampSpreadMode spread_mode = VG_COLOR_RAMP_SPREAD_PAD;
+		int max_stops = 0;
+		bool premultiplied;
+
+		// pattern image
+		VGTilingMode tiling_mode = VG_TILE_FILL;
+		std::shared_ptr<Image> pattern;
+
+		VGuint version = new_version();
+		VGuint ramp_version = new_version();
+
+		void changed() { version = new_version(); }
 	};
 }
 
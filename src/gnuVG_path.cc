@@ -18,6 +18,7 @@
  */
 
 #include "gnuVG_path.hh"
+#include "gnuVG_config.hh"
 
 //#define __DO_GNUVG_DEBUG
 #include "gnuVG_debug.hh"
@@ -192,9 +193,150 @@ namespace gnuVG {
 		/* XXX not implemented */
 	}
 
+	/* The ellipse of an arc, mapped through the linear part of m.
+	 * The radii and rotation of the result come from the singular
+	 * value decomposition of m * rotate(rot) * scale(rh, rv).
+	 */
+	static void transform_arc_ellipse(const Matrix &m, VGfloat *rh, VGfloat *rv, VGfloat *rot) {
+		auto angle = GNUVG_DEG_TO_RAD(*rot);
+		auto cs = cosf(angle), sn = sinf(angle);
+
+		auto p = (m.a * cs + m.d * sn) * *rh;
+		auto q = (m.d * cs - m.a * sn) * *rv;
+		auto r = (m.b * cs + m.e * sn) * *rh;
+		auto s = (m.e * cs - m.b * sn) * *rv;
+
+		auto E = 0.5f * (p + s), F = 0.5f * (p - s);
+		auto G = 0.5f * (r + q), H = 0.5f * (r - q);
+		auto Q = sqrtf(E * E + H * H), R = sqrtf(F * F + G * G);
+
+		*rh = Q + R;
+		*rv = fabsf(Q - R);
+		*rot = 0.5f * (atan2f(H, E) + atan2f(G, F)) * (180.0f / M_PI);
+	}
+
+	// a mirroring transform turns clockwise arcs counter clockwise
+	static VGubyte mirror_arc(VGubyte sgmt) {
+		auto relative = sgmt & 0x00000001;
+		switch(sgmt & ~0x00000001) {
+		case VG_SCCWARC_TO: return VG_SCWARC_TO | relative;
+		case VG_SCWARC_TO: return VG_SCCWARC_TO | relative;
+		case VG_LCCWARC_TO: return VG_LCWARC_TO | relative;
+		case VG_LCWARC_TO: return VG_LCCWARC_TO | relative;
+		}
+		return sgmt;
+	}
+
 	void Path::vgTransformPath(std::shared_ptr<Path> srcPath) {
 		path_dirty = true;
-		/* XXX not implemented */
+
+		auto &m = Context::get_current()->get_matrix(
+			Context::GNUVG_MATRIX_PATH_USER_TO_SURFACE);
+		// relative coordinates are vectors, only the linear part applies
+		Matrix linear;
+		linear.set_to(m);
+		linear.g = linear.h = 0.0f;
+		bool mirrored = m.a * m.e - m.b * m.d < 0.0f;
+
+		static std::vector<size_t> absolute, relative; // coordinate offsets of x, y pairs
+		static std::vector<Point> points;
+		absolute.clear();
+		relative.clear();
+
+		// the source may be this path
+		static std::vector<VGubyte> src_segments;
+		static std::vector<VGfloat> src_coordinates;
+		src_segments.assign(srcPath->s_segments.begin(), srcPath->s_segments.end());
+		src_coordinates.assign(srcPath->s_coordinates.begin(), srcPath->s_coordinates.end());
+
+		Point pen, start;
+		auto dat = src_coordinates.data();
+		for(auto sgmt : src_segments) {
+			auto segtype = sgmt & ~0x00000001;
+			bool is_relative = (sgmt & 0x00000001) == VG_RELATIVE;
+			auto &pairs = is_relative ? relative : absolute;
+			auto first = s_coordinates.size();
+			auto base = is_relative ? pen : Point();
+
+			// h/v lines are lines after a rotation
+			if(segtype == VG_HLINE_TO || segtype == VG_VLINE_TO) {
+				Point end_point = segtype == VG_HLINE_TO ?
+					Point(dat[0], is_relative ? 0.0f : pen.y) :
+					Point(is_relative ? 0.0f : pen.x, dat[0]);
+				s_segments.push_back(VG_LINE_TO | (sgmt & 0x00000001));
+				s_coordinates.push_back(end_point.x);
+				s_coordinates.push_back(end_point.y);
+				pairs.push_back(first);
+				pen = base + end_point;
+				dat += 1;
+				continue;
+			}
+
+			s_segments.push_back(mirrored ? mirror_arc(sgmt) : sgmt);
+
+			size_t nr_pairs = 0;
+			switch(segtype) {
+			case VG_CLOSE_PATH:
+				pen = start;
+				break;
+			case VG_MOVE_TO:
+			case VG_LINE_TO:
+			case VG_SQUAD_TO:
+				nr_pairs = 1;
+				break;
+			case VG_QUAD_TO:
+			case VG_SCUBIC_TO:
+				nr_pairs = 2;
+				break;
+			case VG_CUBIC_TO:
+				nr_pairs = 3;
+				break;
+			case VG_SCCWARC_TO:
+			case VG_SCWARC_TO:
+			case VG_LCCWARC_TO:
+			case VG_LCWARC_TO:
+			{
+				VGfloat rh = dat[0], rv = dat[1], rot = dat[2];
+				transform_arc_ellipse(m, &rh, &rv, &rot);
+				s_coordinates.push_back(rh);
+				s_coordinates.push_back(rv);
+				s_coordinates.push_back(rot);
+				s_coordinates.push_back(dat[3]);
+				s_coordinates.push_back(dat[4]);
+				pairs.push_back(first + 3);
+				pen = base + Point(dat[3], dat[4]);
+				dat += 5;
+			}
+			break;
+			}
+
+			for(size_t k = 0; k < nr_pairs; k++) {
+				pairs.push_back(s_coordinates.size());
+				s_coordinates.push_back(dat[0]);
+				s_coordinates.push_back(dat[1]);
+				if(k + 1 == nr_pairs)
+					pen = base + Point(dat[0], dat[1]);
+				dat += 2;
+			}
+			if(segtype == VG_MOVE_TO)
+				start = pen;
+		}
+
+		// transform the collected pairs in batches
+		auto transform_pairs = [this](const Matrix &mtrx, const std::vector<size_t> &pairs) {
+			points.resize(pairs.size());
+			for(size_t k = 0; k < pairs.size(); k++) {
+				points[k].x = s_coordinates[pairs[k]];
+				points[k].y = s_coordinates[pairs[k] + 1];
+			}
+			mtrx.map_points(points.data(), points.data(), points.size());
+			for(size_t k = 0; k < pairs.size(); k++) {
+				s_coordinates[pairs[k]] = points[k].x;
+				s_coordinates[pairs[k] + 1] = points[k].y;
+			}
+		};
+		transform_pairs(m, absolute);
+		transform_pairs(linear, relative);
 	}
 
 	VGboolean Path::vgInterpolatePath(std::shared_ptr<Path> startPath,
@@ -256,18 +398,189 @@ namespace gnuVG {
 			tess = tessNewTess(ma_p);
 	}
 
+	// antialiasing fringe scratch data
+	static std::vector<Point> fringe_offsets; // half a pixel, outwards
+	static std::vector<GLint> fringe_edge_count;
+	static std::vector<GLfloat> fringe_inset; // x, y
+	static std::vector<GLint> fringe_remap;
+	static std::vector<GLfloat> fringe_vertices; // x, y, coverage
+	static std::vector<GLushort> fringe_indices;
+	static std::vector<GLuint> connected_indices;
+
+	static void render_fringe_chunk() {
+		if(fringe_indices.size() > 0) {
+			Context::get_current()->load_coverage_vertex_array(
+				fringe_vertices.data(), fringe_vertices.size() / 3);
+			Context::get_current()->render_elements(
+				fringe_indices.data(), fringe_indices.size());
+		}
+		std::fill(fringe_remap.begin(), fringe_remap.end(), -1);
+		fringe_vertices.clear();
+		fringe_indices.clear();
+	}
+
+	/* Call edge(a, b, normal) for every boundary edge of the
+	 * tesselation, with its outward unit normal. Polygons are
+	 * in the TESS_CONNECTED_POLYGONS format.
+	 */
+	static void for_each_boundary_edge(
+		const GLfloat *vertices, const TESSindex *polygons, GLsizei nr_polygons,
+		std::function<void(TESSindex, TESSindex, const Point &)> edge) {
+		auto vertex = [vertices](TESSindex k) {
+			return Point(vertices[k << 1], vertices[(k << 1) + 1]);
+		};
+
+		for(GLsizei k = 0; k < nr_polygons; ++k) {
+			auto poly = &polygons[k * TESS_POLY_SIZE * 2];
+			auto neighbours = &poly[TESS_POLY_SIZE];
+			for(int e = 0; e < TESS_POLY_SIZE; ++e) {
+				if(neighbours[e] != TESS_UNDEF) continue;
+
+				auto a = poly[e];
+				auto b = poly[(e + 1) % TESS_POLY_SIZE];
+				auto c = poly[(e + 2) % TESS_POLY_SIZE];
+				auto direction = vertex(b) - vertex(a);
+				auto length = direction.length();
+				if(length == 0.0f) continue;
+
+				// point away from the rest of the triangle
+				Point normal(direction.y / length, -direction.x / length);
+				if(normal.dot(vertex(c) - vertex(a)) > 0.0f)
+					normal = -1.0f * normal;
+				edge(a, b, normal);
+			}
+		}
+	}
+
+	/* The fringe straddles the boundary, half a pixel to each
+	 * side along the miter of the joining edges, measured on the
+	 * surface. Return the vertices with the boundary pulled in by
+	 * half a pixel, for the interior, or nullptr when there is
+	 * nothing to fringe.
+	 */
+	const GLfloat *Path::vgDrawPath_inset_fill(const GLfloat *vertices, GLsizei nr_vertices,
+						   const TESSindex *polygons, GLsizei nr_polygons) {
+		ADD_GNUVG_PROFILER_PROBE(path_inset_fill);
+		auto ctx = Context::get_current();
+
+		// the linear part of the matrix, and its inverse
+		auto origo = ctx->map_point(Point(0.0f, 0.0f));
+		auto ex = ctx->map_point(Point(1.0f, 0.0f)) - origo;
+		auto ey = ctx->map_point(Point(0.0f, 1.0f)) - origo;
+		auto det = ex.x * ey.y - ey.x * ex.y;
+		if(det == 0.0f) return nullptr;
+		auto to_surface = [ex, ey](const Point &v) {
+			return v.x * ex + v.y * ey;
+		};
+		auto to_path = [ex, ey, det](const Point &v) {
+			return Point((ey.y * v.x - ey.x * v.y) / det,
+				     (ex.x * v.y - ex.y * v.x) / det);
+		};
+
+		// sum up the unit normals of the edges on the surface
+		fringe_offsets.assign(nr_vertices, Point());
+		fringe_edge_count.assign(nr_vertices, 0);
+		for_each_boundary_edge(
+			vertices, polygons, nr_polygons,
+			[vertices, to_surface](TESSindex a, TESSindex b, const Point &normal) {
+				auto direction = to_surface(
+					Point(vertices[b << 1] - vertices[a << 1],
+					      vertices[(b << 1) + 1] - vertices[(a << 1) + 1]));
+				auto length = direction.length();
+				if(length == 0.0f) return;
+
+				// a linear map keeps the outside on the same side
+				Point surface_normal(direction.y / length, -direction.x / length);
+				if(surface_normal.dot(to_surface(normal)) < 0.0f)
+					surface_normal = -1.0f * surface_normal;
+
+				fringe_offsets[a] += surface_normal;
+				fringe_offsets[b] += surface_normal;
+				fringe_edge_count[a]++;
+				fringe_edge_count[b]++;
+			});
+
+		fringe_inset.assign(vertices, vertices + 2 * nr_vertices);
+		for(GLsizei k = 0; k < nr_vertices; ++k) {
+			// where two unit normals meet, their sum s is
+			// 2cos(a/2) long, and the miter is 2s / |s|^2
+			auto sum = fringe_offsets[k];
+			auto square = sum.dot(sum);
+			if(square <= 0.0f) {
+				fringe_offsets[k] = Point();
+				continue;
+			}
+			auto miter = (fringe_edge_count[k] / square) * sum;
+			auto length = miter.length();
+			if(length > GNUVG_FRINGE_MITER_LIMIT)
+				miter = (GNUVG_FRINGE_MITER_LIMIT / length) * miter;
+
+			fringe_offsets[k] = to_path(0.5f * miter);
+			fringe_inset[k << 1] -= fringe_offsets[k].x;
+			fringe_inset[(k << 1) + 1] -= fringe_offsets[k].y;
+		}
+		return fringe_inset.data();
+	}
+
+	/* Extrude a one pixel wide fringe, fading to transparent,
+	 * across the boundary edges of the tesselation, using the
+	 * offsets from vgDrawPath_inset_fill().
+	 */
+	void Path::vgDrawPath_fill_fringe(const GLfloat *vertices, GLsizei nr_vertices,
+					  const TESSindex *polygons, GLsizei nr_polygons) {
+		ADD_GNUVG_PROFILER_PROBE(path_fill_fringe);
+
+		fringe_remap.assign(nr_vertices, -1);
+		fringe_vertices.clear();
+		fringe_indices.clear();
+
+		// inner vertice at even, outer at odd index
+		auto fringe_vertice = [vertices](TESSindex k) {
+			if(fringe_remap[k] < 0) {
+				Point p(vertices[k << 1], vertices[(k << 1) + 1]);
+				auto inner = p - fringe_offsets[k];
+				auto outer = p + fringe_offsets[k];
+
+				fringe_remap[k] = fringe_vertices.size() / 3;
+				fringe_vertices.insert(
+					fringe_vertices.end(),
+					{inner.x, inner.y, 1.0f,
+					 outer.x, outer.y, 0.0f});
+			}
+			return (GLushort)fringe_remap[k];
+		};
+
+		for_each_boundary_edge(
+			vertices, polygons, nr_polygons,
+			[fringe_vertice](TESSindex a, TESSindex b, const Point &) {
+				if(fringe_vertices.size() / 3 + 4 > GNUVG_MAX_INDEXED_VERTICES)
+					render_fringe_chunk();
+
+				auto ia = fringe_vertice(a);
+				auto ib = fringe_vertice(b);
+				fringe_indices.insert(
+					fringe_indices.end(),
+					{ia, ib, (GLushort)(ia + 1),
+					 ib, (GLushort)(ib + 1), (GLushort)(ia + 1)});
+			});
+
+		render_fringe_chunk();
+	}
+
 	void Path::vgDrawPath_fill_regular() {
 		const GLfloat *vertices = NULL;
 		const GLuint *indices = NULL;
 		GLsizei nr_indices;
 
 		bool was_tesselated;
+		bool antialiased = Context::get_current()->antialiasing_enabled();
 
 		{
 			ADD_GNUVG_PROFILER_PROBE(path_tesselate);
 			was_tesselated = tessTesselate(tess,
 						       TESS_WINDING_ODD,
-						       TESS_POLYGONS, TESS_POLY_SIZE, 2, 0) ? true : false;
+						       antialiased ? TESS_CONNECTED_POLYGONS : TESS_POLYGONS,
+						       TESS_POLY_SIZE, 2, 0) ? true : false;
 		}
 
 		GNUVG_DEBUG("vgDrawPath_fill_regular()\n");
@@ -279,12 +592,34 @@ namespace gnuVG {
 				nr_indices = (GLsizei)          tessGetElementCount(tess) * TESS_POLY_SIZE;
 			}
 
+			const TESSindex *polygons = tessGetElements(tess);
+			if(antialiased && indices != NULL) {
+				// connected polygons are followed by their neighbours
+				connected_indices.clear();
+				for(GLsizei k = 0; k < nr_indices; k += TESS_POLY_SIZE)
+					connected_indices.insert(
+						connected_indices.end(),
+						&indices[k * 2], &indices[k * 2 + TESS_POLY_SIZE]);
+				indices = connected_indices.data();
+			}
+
 			if(vertices != NULL && indices != NULL) {
 //			GNUVG_DEBUG("    vgDrawPath: vertices(%p), indices(%p), nr indices(%d)\n", vertices, indices, nr_indices);
+				auto nr_vertices = tessGetVertexCount(tess);
+				auto nr_polygons = tessGetElementCount(tess);
+				auto inset = antialiased ?
+					vgDrawPath_inset_fill(vertices, nr_vertices,
+							      polygons, nr_polygons) : nullptr;
+
 				Context::get_current()->use_pipeline(Context::GNUVG_SIMPLE_PIPELINE,
 								     VG_FILL_PATH);
-				Context::get_current()->load_2dvertex_array(vertices, 0);
-				Context::get_current()->render_elements(indices, nr_indices);
+				Context::get_current()->render_mesh(
+					inset ? inset : vertices, nr_vertices,
+					indices, nr_indices);
+				if(inset)
+					vgDrawPath_fill_fringe(
+						vertices, nr_vertices,
+						polygons, nr_polygons);
 			}
 		}
 	}
@@ -308,17 +643,33 @@ namespace gnuVG {
 				Context::GNUVG_SIMPLE_PIPELINE,
 				VG_STROKE_PATH);
 
-			simplified.get_stroke_shape(
-				[](const SimplifiedPath::StrokeData &stroke_data) {
-					if(stroke_data.nr_vertices) {
-						Context::get_current()->load_2dvertex_array(
-							stroke_data.vertices, 0);
-						Context::get_current()->render_elements(
-							stroke_data.indices,
-							stroke_data.nr_indices);
+			if(Context::get_current()->stroke_is_hairline()) {
+				simplified.get_hairline_shape(
+					[](const SimplifiedPath::StrokeData &stroke_data) {
+						if(stroke_data.nr_vertices) {
+							Context::get_current()->load_stroke_vertex_array(
+								stroke_data.vertices,
+								stroke_data.nr_vertices);
+							Context::get_current()->render_line_elements(
+								stroke_data.indices,
+								stroke_data.nr_indices);
+						}
 					}
-				}
-				);
+					);
+			} else {
+				simplified.get_stroke_shape(
+					[](const SimplifiedPath::StrokeData &stroke_data) {
+						if(stroke_data.nr_vertices) {
+							Context::get_current()->load_stroke_vertex_array(
+								stroke_data.vertices,
+								stroke_data.nr_vertices);
+							Context::get_current()->render_elements(
+								stroke_data.indices,
+								stroke_data.nr_indices);
+						}
+					}
+					);
+			}
 		}
 		Context::get_current()->calculate_bounding_box(bounding_box);
 	}
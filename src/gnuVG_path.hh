@@ -53,6 +53,10 @@ namespace gnuVG {
 		void vgDrawPath_tesselate_subpath();
 
 		void vgDrawPath_fill_regular(); // regular tesselation
+		const GLfloat *vgDrawPath_inset_fill(const GLfloat *vertices, GLsizei nr_vertices,
+						     const TESSindex *polygons, GLsizei nr_polygons);
+		void vgDrawPath_fill_fringe(const GLfloat *vertices, GLsizei nr_vertices,
+					    const TESSindex *polygons, GLsizei nr_polygons);
 		void vgDrawPath_stroke();
 
 		void cleanup_path();
@@ -0,0 +1,223 @@
+/*
+ * gnuVG - a free Vector Graphics library
+ * Copyright (C) 2016 by Anton Persson
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <dirent.h>
+#include <mutex>
+#include <EGL/egl.h>
+
+#include "gnuVG_programcache.hh"
+#include "gnuVG_config.hh"
+
+//#define __DO_GNUVG_DEBUG
+#include "gnuVG_debug.hh"
+
+namespace gnuVG {
+
+	std::string ProgramCache::directory;
+	int ProgramCache::supported = -1;
+
+	// "gVGp" - file header followed by the binary
+	static const GLuint cache_magic = 0x70475667;
+
+	struct CacheHeader {
+		GLuint magic;
+		GLuint generator_version;
+		GLuint driver;
+		GLint caps;
+		GLenum format;
+		GLint length;
+	};
+
+	static const char cache_prefix[] = "gnuvg-";
+	static const char cache_suffix[] = ".bin";
+
+	// extension entry points are not always exported, look them up
+	static PFNGLGETPROGRAMBINARYOESPROC get_program_binary = nullptr;
+	static PFNGLPROGRAMBINARYOESPROC program_binary = nullptr;
+
+	/* The shader compiler thread uses the cache too, while the
+	 * directory may change and gaussian programs are stored from
+	 * the main thread.
+	 */
+	static std::mutex support_lock;
+	static std::mutex directory_lock;
+	static std::mutex store_lock; // one writer of the temporary files
+
+	void ProgramCache::set_directory(const std::string &_directory) {
+		std::lock_guard<std::mutex> guard(directory_lock);
+		directory = _directory;
+	}
+
+	std::string ProgramCache::get_directory() {
+		std::lock_guard<std::mutex> guard(directory_lock);
+		return directory;
+	}
+
+	bool ProgramCache::is_supported() {
+		std::lock_guard<std::mutex> guard(support_lock);
+		if(supported < 0) {
+			auto extensions = (const char *)glGetString(GL_EXTENSIONS);
+			GLint nr_formats = 0;
+			if(extensions && strstr(extensions, "GL_OES_get_program_binary")) {
+				get_program_binary = (PFNGLGETPROGRAMBINARYOESPROC)
+					eglGetProcAddress("glGetProgramBinaryOES");
+				program_binary = (PFNGLPROGRAMBINARYOESPROC)
+					eglGetProcAddress("glProgramBinaryOES");
+				glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &nr_formats);
+			}
+			supported = (nr_formats > 0 &&
+				     get_program_binary && program_binary) ? 1 : 0;
+		}
+		return supported == 1;
+	}
+
+	std::string ProgramCache::path_for(const std::string &directory, int caps) {
+		char name[32];
+		snprintf(name, sizeof(name), "%s%08x%s", cache_prefix, caps, cache_suffix);
+		return directory + "/" + name;
+	}
+
+	// binaries are only valid for the driver that produced them
+	GLuint ProgramCache::driver_hash() {
+		GLuint hash = 2166136261u; // FNV-1a
+		for(auto name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+			auto str = (const char *)glGetString(name);
+			for(; str && *str; str++)
+				hash = (hash ^ (unsigned char)*str) * 16777619u;
+			hash = (hash ^ '|') * 16777619u;
+		}
+		return hash;
+	}
+
+	std::vector<int> ProgramCache::list_cached() {
+		std::vector<int> retval;
+		auto directory = get_directory();
+		if(directory.empty() || !is_supported())
+			return retval;
+
+		auto dir = opendir(directory.c_str());
+		if(!dir)
+			return retval;
+
+		auto prefix_length = strlen(cache_prefix);
+		while(auto entry = readdir(dir)) {
+			unsigned int caps;
+			char suffix[8];
+			if(strncmp(entry->d_name, cache_prefix, prefix_length) == 0 &&
+			   sscanf(entry->d_name + prefix_length, "%8x%7s", &caps, suffix) == 2 &&
+			   strcmp(suffix, cache_suffix) == 0)
+				retval.push_back((int)caps);
+		}
+		closedir(dir);
+
+		return retval;
+	}
+
+	GLuint ProgramCache::load(int caps) {
+		auto directory = get_directory();
+		if(directory.empty() || !is_supported())
+			return 0;
+
+		// stored files are renamed into place, never seen half written
+		auto file = fopen(path_for(directory, caps).c_str(), "rb");
+		if(!file)
+			return 0;
+
+		CacheHeader header;
+		std::vector<char> binary;
+		bool valid =
+			fread(&header, sizeof(header), 1, file) == 1 &&
+			header.magic == cache_magic &&
+			header.generator_version == GNUVG_SHADER_GENERATOR_VERSION &&
+			header.driver == driver_hash() &&
+			header.caps == caps &&
+			header.length > 0;
+		if(valid) {
+			binary.resize(header.length);
+			valid = fread(binary.data(), header.length, 1, file) == 1;
+		}
+		fclose(file);
+
+		if(!valid) {
+			GNUVG_DEBUG("ProgramCache::load() - stale or broken binary for %x\n", caps);
+			return 0;
+		}
+
+		auto program = glCreateProgram();
+		program_binary(program, header.format, binary.data(), header.length);
+
+		// the driver may still reject it, after an update for example
+		GLint link_status = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &link_status);
+		if(link_status != GL_TRUE) {
+			GNUVG_DEBUG("ProgramCache::load() - driver rejected binary for %x\n", caps);
+			glDeleteProgram(program);
+			return 0;
+		}
+
+		return program;
+	}
+
+	void ProgramCache::store(int caps, GLuint program) {
+		auto directory = get_directory();
+		if(directory.empty() || !program || !is_supported())
+			return;
+
+		CacheHeader header;
+		header.magic = cache_magic;
+		header.generator_version = GNUVG_SHADER_GENERATOR_VERSION;
+		header.driver = driver_hash();
+		header.caps = caps;
+		header.length = 0;
+
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH_OES, &header.length);
+		if(header.length <= 0)
+			return;
+
+		std::vector<char> binary(header.length);
+		GLsizei length = 0;
+		get_program_binary(program, header.length, &length,
+				   &header.format, binary.data());
+		if(length <= 0)
+			return;
+		header.length = length;
+
+		// write to a temporary first, so a crash never leaves half a file
+		std::lock_guard<std::mutex> guard(store_lock);
+		auto path = path_for(directory, caps);
+		auto temporary = path + ".tmp";
+		auto file = fopen(temporary.c_str(), "wb");
+		if(!file) {
+			GNUVG_ERROR("ProgramCache::store() - could not write %s\n", temporary.c_str());
+			return;
+		}
+		bool written =
+			fwrite(&header, sizeof(header), 1, file) == 1 &&
+			fwrite(binary.data(), length, 1, file) == 1;
+		written = fclose(file) == 0 && written;
+
+		if(!written || rename(temporary.c_str(), path.c_str()) != 0) {
+			GNUVG_ERROR("ProgramCache::store() - could not write %s\n", path.c_str());
+			remove(temporary.c_str());
+		}
+	}
+
+};
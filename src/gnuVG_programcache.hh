@@ -0,0 +1,56 @@
+/*
+ * gnuVG - a free Vector Graphics library
+ * Copyright (C) 2016 by Anton Persson
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+
+namespace gnuVG {
+
+	/* Linked shader programs stored on disk through
+	 * GL_OES_get_program_binary, one file per capability set.
+	 * A binary is only accepted when it was written by the same
+	 * shader generator version for the same driver.
+	 */
+	class ProgramCache {
+	public:
+		// an empty directory disables the cache
+		static void set_directory(const std::string &directory);
+
+		// the capability sets that have a binary in the directory
+		static std::vector<int> list_cached();
+
+		// returns a linked program, or 0 if none could be loaded
+		static GLuint load(int caps);
+		static void store(int caps, GLuint program);
+
+	private:
+		static std::string directory; // read through get_directory()
+		static int supported; // -1 when not yet checked
+
+		static std::string get_directory();
+		static bool is_supported();
+		static std::string path_for(const std::string &directory, int caps);
+		static GLuint driver_hash();
+	};
+
+};
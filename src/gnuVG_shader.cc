@@ -17,8 +17,16 @@
  *
  */
 
+#include <algorithm>
+#include <limits>
 #include <sstream>
 #include "gnuVG_shader.hh"
+#include "gnuVG_config.hh"
+#include "gnuVG_glstate.hh"
+#include "gnuVG_programcache.hh"
+#include "gnuVG_shadercompiler.hh"
+#include "gnuVG_shadertable.hh"
+#include "gnuVG_gaussianblur.hh"
 
 //#define __DO_GNUVG_DEBUG
 #include "gnuVG_debug.hh"
@@ -26,8 +34,6 @@
 #define ENABLE_GNUVG_PROFILER
 #include <VG/gnuVG_profiler.hh>
 
-#include "gnuVG_gaussianblur.hh"
-
 namespace gnuVG {
 	std::map<int, Shader*> Shader::shader_library;
 
@@ -37,25 +43,170 @@ namespace gnuVG {
 			return (*found).second;
 		}
 
-		auto new_shader = new Shader(caps);
+		adopt_compiled_programs();
+		found = shader_library.find(caps);
+		if(found != shader_library.end()) {
+			return (*found).second;
+		}
+
+		// the gaussian blur is not in the generic shader
+		if(ShaderCompiler::is_running() &&
+		   caps != do_generic &&
+		   !(caps & do_gaussian)) {
+			ShaderCompiler::request(caps);
+			return get_shader(do_generic);
+		}
+
+		ADD_GNUVG_PROFILER_PROBE(SH_build_program);
+		auto new_shader = new Shader(caps, load_or_build_program(caps));
 		shader_library[caps] = new_shader;
 		return new_shader;
 	}
 
-	void Shader::use_shader() const {
-		glUseProgram(program_id);
-		set_blending(blend_src_over);
+	// no profiler probes here, they are not thread safe
+	GLuint Shader::load_or_build_program(int caps) {
+		auto program = ProgramCache::load(caps);
+		if(!program) {
+			program = build_program(caps);
+			ProgramCache::store(caps, program);
+		}
+		return program;
+	}
+
+	void Shader::adopt_compiled_programs() {
+		static std::vector<std::pair<int, GLuint> > compiled;
+
+		compiled.clear();
+		ShaderCompiler::collect(compiled);
+		for(auto &c : compiled) {
+			if(shader_library.find(c.first) == shader_library.end())
+				shader_library[c.first] = new Shader(c.first, c.second);
+			else
+				glDeleteProgram(c.second);
+		}
+	}
+
+	void Shader::precompile(int primary_modes, int flags) {
+		ADD_GNUVG_PROFILER_PROBE(SH_precompile);
+
+		for(size_t k = 0; k < shader_table_size; k++) {
+			auto caps = shader_table[k].caps;
+			if(!(primary_modes & (1 << (caps & primary_mode_mask))) ||
+			   (caps & ~(primary_mode_mask | flags)))
+				continue;
+			if(shader_library.find(caps) != shader_library.end())
+				continue;
+			if(ShaderCompiler::is_running())
+				ShaderCompiler::request(caps);
+			else
+				get_shader(caps);
+		}
+	}
+
+	void Shader::load_cached_programs() {
+		for(auto caps : ProgramCache::list_cached()) {
+			if(shader_library.find(caps) != shader_library.end())
+				continue;
+			if(auto program = ProgramCache::load(caps))
+				shader_library[caps] = new Shader(caps, program);
+		}
+	}
+
+	void Shader::use_shader(int capabilities) const {
+		GLState::get_current()->use_program(program_id);
+		if(caps == do_generic)
+			select_generic_features(capabilities);
+	}
+
+	void Shader::select_generic_features(int generic_caps) const {
+		auto primary_mode = generic_caps & primary_mode_mask;
+		if(selected_generic_caps != generic_caps) {
+			selected_generic_caps = generic_caps;
+			glUniform1i(generic_mode, primary_mode);
+			glUniform1i(generic_spread,
+				    (generic_caps & gradient_spread_mask) >> 4);
+			for(size_t k = 0; k < nr_generic_flags; k++)
+				glUniform1i(generic_flag_handles[k],
+					    (generic_caps & generic_flags[k].cap) ? 1 : 0);
+		}
+
+		/* All attributes are active in the generic shader, those
+		 * the draw will not load must not be left enabled
+		 * pointing at the data of an earlier draw.
+		 */
+		auto state = GLState::get_current();
+		bool stroke = generic_caps & do_stroke_extrusion;
+		bool coverage = generic_caps & do_coverage;
+		if(primary_mode != do_vertex_color)
+			state->disable_vertex_attrib_array(color_handle);
+		if(!stroke)
+			state->disable_vertex_attrib_array(extrusion_handle);
+		if(!(generic_caps & do_dash))
+			state->disable_vertex_attrib_array(arc_length_handle);
+		if(!(generic_caps & do_disc))
+			state->disable_vertex_attrib_array(disc_handle);
+		if(!(coverage && stroke))
+			state->disable_vertex_attrib_array(side_handle);
+		if(!coverage || stroke)
+			state->disable_vertex_attrib_array(coverage_handle);
+		if(primary_mode != do_texture && !(generic_caps & do_texture_alpha))
+			state->disable_vertex_attrib_array(textureCoord_handle);
+	}
+
+	bool Shader::scalar_changed(ScalarSlot slot, GLint location, GLfloat value) const {
+		if(location < 0 || scalar_cache[slot] == value)
+			return false;
+		scalar_cache[slot] = value;
+		return true;
+	}
+
+	bool Shader::vector_changed(VectorSlot slot, GLint location,
+				    const GLfloat *values, GLsizei count) const {
+		if(location < 0) return false;
+
+		auto &cached = vector_cache[slot];
+		if(count > (GLsizei)(sizeof(cached.values) / sizeof(cached.values[0]))) {
+			cached.count = 0; // too long to keep
+			return true;
+		}
+		if(cached.count == count &&
+		   std::equal(values, values + count, cached.values))
+			return false;
+
+		cached.count = count;
+		std::copy(values, values + count, cached.values);
+		return true;
+	}
+
+	bool Shader::version_changed(VersionSlot slot, GLuint version) const {
+		if(version != 0 && uploaded_version[slot] == version)
+			return false;
+		uploaded_version[slot] = version;
+		return true;
+	}
+
+	void Shader::set_uniform1f(ScalarSlot slot, GLint location, GLfloat value) const {
+		if(scalar_changed(slot, location, value))
+			glUniform1f(location, value);
+	}
+
+	void Shader::set_uniform1i(ScalarSlot slot, GLint location, GLint value) const {
+		// cached as a float, which is exact for our small ints
+		if(scalar_changed(slot, location, (GLfloat)value))
+			glUniform1i(location, value);
 	}
 
 	void Shader::set_blending(Blending bmode) const {
+		auto state = GLState::get_current();
+
 		switch(bmode) {
 		case blend_src: // blend_src equals no blending
-			glDisable(GL_BLEND);
+			state->set_blend(false);
 			break;
 
 		case blend_src_in:
-			glEnable(GL_BLEND);
-			glBlendFuncSeparate(
+			state->set_blend(true);
+			state->blend_func(
 				GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA,
 				GL_DST_ALPHA, GL_ZERO);
 			break;
@@ -71,411 +222,260 @@ namespace gnuVG {
 		case blend_src_over:
 			// everything not supported
 			// will default into src_over
-			glEnable(GL_BLEND);
-			glBlendFuncSeparate(
+			state->set_blend(true);
+			state->blend_func(
 				GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA,
 				GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 			break;
 		}
 	}
 
-	void Shader::set_matrix(const GLfloat *m) const {
-		glUniformMatrix4fv(Matrix, 1, GL_FALSE, m);
+	void Shader::set_matrix(const GLfloat *m, GLuint version) const {
+		if(version_changed(version_matrix, version))
+			glUniformMatrix4fv(Matrix, 1, GL_FALSE, m);
 	}
 
 	void Shader::set_pre_translation(const GLfloat *ptrans) const {
-		glUniform2fv(preTranslation, 1, ptrans);
+		if(vector_changed(vector_pre_translation, preTranslation, ptrans, 2))
+			glUniform2fv(preTranslation, 1, ptrans);
 	}
 
-	void Shader::set_surf2paint_matrix(const GLfloat *s2p_matrix) const {
-		glUniformMatrix4fv(surf2paint, 1, GL_FALSE, s2p_matrix);
+	void Shader::set_surf2paint_matrix(const GLfloat *s2p_matrix, GLuint version) const {
+		if(version_changed(version_surf2paint, version))
+			glUniformMatrix4fv(surf2paint, 1, GL_FALSE, s2p_matrix);
 	}
 
 	void Shader::set_mask_texture(GLuint tex) const {
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, tex);
-		glUniform1i(maskTexture, 1);
+		GLState::get_current()->bind_texture(1, tex);
+		set_uniform1i(scalar_mask_texture, maskTexture, 1);
+	}
+
+	/* The gaussian kernel for a diameter, as the vec4 that the
+	 * shader reads - (weight, offset) of two samples each. The
+	 * sigma search is slow, so every diameter is computed once.
+	 */
+	static const std::vector<GLfloat> &gaussian_kernel(int diameter) {
+		static std::map<int, std::vector<GLfloat> > kernels;
+
+		diameter = std::min(diameter | 1, (int)Shader::max_gaussian_diameter);
+		auto found = kernels.find(diameter);
+		if(found != kernels.end())
+			return found->second;
+
+		std::vector<float> weights, offsets;
+		GetSeparableGaussWeightsAndOffsets(diameter, weights, offsets);
+
+		auto &kernel = kernels[diameter];
+		for(size_t k = 0; k < weights.size(); k++) {
+			kernel.push_back(weights[k]);
+			kernel.push_back(offsets[k]);
+		}
+		// an unused sample has no weight
+		kernel.resize(((kernel.size() + 3) / 4) * 4, 0.0f);
+		return kernel;
 	}
 
-	void Shader::set_pattern_size(GLint width_in_pixels, GLint height_in_pixels) const {
-		auto pixel_width = (GLfloat)1.0 / (GLfloat)width_in_pixels;
-		auto pixel_height = (GLfloat)1.0 / (GLfloat)height_in_pixels;
+	int Shader::gaussian_caps(int diameter) {
+		int pairs = gaussian_kernel(diameter).size() / 4;
+		int size = 2;
+		while(size < pairs)
+			size *= 2;
+		return do_gaussian | (size << gauss_kernel_shift);
+	}
 
-		GLfloat pxs[] = {
-			pixel_width,
-			pixel_height,
-			pixel_width * (GLfloat)0.5,
-			pixel_height * (GLfloat)0.5
-		};
+	void Shader::set_gaussian_kernel(int diameter, GLfloat step_x, GLfloat step_y) const {
+		if(scalar_changed(scalar_gauss_diameter, gaussKernel, diameter)) {
+			auto &kernel = gaussian_kernel(diameter);
+			glUniform4fv(gaussKernel, kernel.size() / 4, kernel.data());
+			glUniform1i(gaussPairs, kernel.size() / 4);
+		}
 
-		glUniform4fv(pxl_sizes, 1, pxs);
+		GLfloat step[] = { step_x, step_y };
+		if(vector_changed(vector_gauss_step, gaussStep, step, 2))
+			glUniform2fv(gaussStep, 1, step);
 	}
 
 	void Shader::set_pattern_matrix(const GLfloat *mtrx) const {
-		glUniformMatrix4fv(patternMatrix, 1, GL_FALSE, mtrx);
+		if(vector_changed(vector_pattern_matrix, patternMatrix, mtrx, 16))
+			glUniformMatrix4fv(patternMatrix, 1, GL_FALSE, mtrx);
 	}
 
 	void Shader::set_pattern_texture(GLuint tex) const {
-		glActiveTexture(GL_TEXTURE2);
-		glBindTexture(GL_TEXTURE_2D, tex);
-		glUniform1i(patternTexture, 2);
-	}
-
-	void Shader::set_wrap_mode(GLuint wrap_mode) const {
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap_mode);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap_mode);
+		GLState::get_current()->bind_texture(2, tex);
+		set_uniform1i(scalar_pattern_texture, patternTexture, 2);
 	}
 
 	void Shader::set_color_transform(const GLfloat *scale,
 					 const GLfloat *bias) const {
-		glUniform4fv(ctransform_scale, 1, scale);
-		glUniform4fv(ctransform_bias, 1, bias);
+		if(vector_changed(vector_ctransform_scale, ctransform_scale, scale, 4))
+			glUniform4fv(ctransform_scale, 1, scale);
+		if(vector_changed(vector_ctransform_bias, ctransform_bias, bias, 4))
+			glUniform4fv(ctransform_bias, 1, bias);
 	}
 
-	void Shader::set_color(const GLfloat *clr) const {
-		glUniform4fv(ColorHandle, 1, clr);
+	void Shader::set_color(const GLfloat *clr, GLuint version) const {
+		if(version_changed(version_color, version))
+			glUniform4fv(ColorHandle, 1, clr);
 	}
 
-	void Shader::set_linear_parameters(const GLfloat *vec) const {
+	void Shader::set_linear_parameters(const GLfloat *vec, GLuint version) const {
+		if(!version_changed(version_gradient, version)) return;
 		glUniform2fv(linear_start, 1, &(vec[0]));
 		glUniform2fv(linear_normal, 1, &(vec[2]));
 		glUniform1fv(linear_length, 1, &(vec[4]));
 	}
 
-	void Shader::set_radial_parameters(const GLfloat *vec) const {
+	void Shader::set_radial_parameters(const GLfloat *vec, GLuint version) const {
+		if(!version_changed(version_gradient, version)) return;
 		glUniform4fv(radial, 1, &(vec[0]));
 		glUniform1fv(radius2, 1, &(vec[4]));
 		glUniform1fv(radial_denom, 1, &(vec[5]));
 	}
 
-	void Shader::set_color_ramp(GLuint max_stops,
-				    const GLfloat *offsets,
-				    const GLfloat *invfactor,
-				    const GLfloat *colors) const {
-		glUniform1fv(stop_offsets,
-			     max_stops, offsets);
-		glUniform1fv(stop_invfactor,
-			     max_stops, invfactor);
-		glUniform4fv(stop_colors,
-			     max_stops, colors);
-		glUniform1i(nr_stops, max_stops);
+	void Shader::set_color_ramp(GLuint texture, GLfloat row) const {
+		GLState::get_current()->bind_texture(4, texture);
+		set_uniform1i(scalar_ramp_texture, rampTexture, 4);
+		set_uniform1f(scalar_ramp_row, rampRow, row);
+	}
+
+	void Shader::set_two_stop_ramp(const GLfloat *offsets,
+				       const GLfloat *invfactor,
+				       const GLfloat *colors,
+				       GLuint version) const {
+		if(!version_changed(version_color_ramp, version)) return;
+		glUniform4fv(rampStart, 1, &(colors[0]));
+		glUniform4fv(rampEnd, 1, &(colors[4]));
+		GLfloat span[] = { offsets[0], invfactor[0] };
+		glUniform2fv(rampSpan, 1, span);
 	}
 
 	void Shader::load_2dvertex_array(const GLfloat *verts, GLint stride) const {
 		ADD_GNUVG_PROFILER_PROBE(SH_load_2dvertex_array);
 
-		glVertexAttribPointer(position_handle, 2, GL_FLOAT, GL_FALSE,
-				      stride * sizeof(GLfloat), verts);
-		glEnableVertexAttribArray(position_handle);
+		GLState::get_current()->vertex_attrib_pointer(
+			position_handle, 2, stride * sizeof(GLfloat), verts);
 	}
 
 	void Shader::load_2dvertex_texture_array(const GLfloat *verts, GLint stride) const {
 		ADD_GNUVG_PROFILER_PROBE(SH_load_2dvertex_texture_array);
 
-		glVertexAttribPointer(textureCoord_handle, 2, GL_FLOAT, GL_FALSE,
-				      stride * sizeof(GLfloat), verts);
-		glEnableVertexAttribArray(textureCoord_handle);
+		GLState::get_current()->vertex_attrib_pointer(
+			textureCoord_handle, 2, stride * sizeof(GLfloat), verts);
+	}
+
+	void Shader::load_vertex_color_array(const GLfloat *colors, GLint stride) const {
+		GLState::get_current()->vertex_attrib_pointer(
+			color_handle, 4, stride * sizeof(GLfloat), colors);
+	}
+
+	void Shader::load_extrusion_array(const GLfloat *extrusions, GLint stride) const {
+		GLState::get_current()->vertex_attrib_pointer(
+			extrusion_handle, 2, stride * sizeof(GLfloat), extrusions);
+	}
+
+	void Shader::set_stroke_width(GLfloat width) const {
+		set_uniform1f(scalar_stroke_width, strokeWidth, width);
+	}
+
+	void Shader::set_viewport_size(GLint width_in_pixels, GLint height_in_pixels) const {
+		GLfloat half[] = {
+			0.5f * (GLfloat)width_in_pixels,
+			0.5f * (GLfloat)height_in_pixels
+		};
+		if(vector_changed(vector_viewport_half, viewportHalf, half, 2))
+			glUniform2fv(viewportHalf, 1, half);
+	}
+
+	void Shader::load_arc_length_array(const GLfloat *arc_lengths, GLint stride) const {
+		if(arc_length_handle < 0) return; // not dashed
+		GLState::get_current()->vertex_attrib_pointer(
+			arc_length_handle, 1, stride * sizeof(GLfloat), arc_lengths);
+	}
+
+	void Shader::load_disc_array(const GLfloat *disc_flags, GLint stride) const {
+		if(disc_handle < 0) return; // no round joins or caps
+		GLState::get_current()->vertex_attrib_pointer(
+			disc_handle, 1, stride * sizeof(GLfloat), disc_flags);
+	}
+
+	void Shader::load_side_array(const GLfloat *sides, GLint stride) const {
+		if(side_handle < 0) return; // not antialiased
+		GLState::get_current()->vertex_attrib_pointer(
+			side_handle, 1, stride * sizeof(GLfloat), sides);
+	}
+
+	void Shader::set_stroke_half_width(GLfloat half_width_in_pixels) const {
+		set_uniform1f(scalar_half_width, halfWidthPixels, half_width_in_pixels);
+	}
+
+	void Shader::load_coverage_array(const GLfloat *coverage, GLint stride) const {
+		if(coverage_handle < 0) return; // not antialiased
+		GLState::get_current()->vertex_attrib_pointer(
+			coverage_handle, 1, stride * sizeof(GLfloat), coverage);
+	}
+
+	void Shader::set_full_coverage() const {
+		if(coverage_handle < 0) return; // not antialiased
+		auto state = GLState::get_current();
+		state->disable_vertex_attrib_array(coverage_handle);
+		state->vertex_attrib_1f(coverage_handle, 1.0f);
+	}
+
+	void Shader::set_dash_pattern(const GLfloat *dash_ends, GLint nr_dashes,
+				      GLfloat phase) const {
+		if(vector_changed(vector_dash_ends, dashEnds, dash_ends, nr_dashes))
+			glUniform1fv(dashEnds, nr_dashes, dash_ends);
+		set_uniform1i(scalar_nr_dashes, nrDashes, nr_dashes);
+		set_uniform1f(scalar_dash_period, dashPeriod, dash_ends[nr_dashes - 1]);
+		set_uniform1f(scalar_dash_phase, dashPhase, phase);
 	}
 
 	void Shader::set_texture_matrix(const GLfloat *mtrx) const {
-		glUniformMatrix3fv(textureMatrix_handle, 1, GL_FALSE, mtrx);
+		if(vector_changed(vector_texture_matrix, textureMatrix_handle, mtrx, 9))
+			glUniformMatrix3fv(textureMatrix_handle, 1, GL_FALSE, mtrx);
 	}
 
 	void Shader::set_texture(GLuint tex) const {
-		glActiveTexture(GL_TEXTURE3);
-		glBindTexture(GL_TEXTURE_2D, tex);
-		glUniform1i(textureSampler_handle, 3);
+		GLState::get_current()->bind_texture(3, tex);
+		set_uniform1i(scalar_texture_sampler, textureSampler_handle, 3);
 	}
 
 	void Shader::render_triangles(GLint first, GLsizei count) const {
 		glDrawArrays(GL_TRIANGLES, first, count);
 	}
 
-	void Shader::render_elements(const GLuint *indices, GLsizei nr_indices) const {
+	void Shader::render_elements(const GLushort *indices, GLsizei nr_indices) const {
 		ADD_GNUVG_PROFILER_PROBE(SH_render_elements);
 		ADD_GNUVG_PROFILER_COUNTER(SH_render_elements, nr_indices);
 
-		glDrawElements(GL_TRIANGLES, nr_indices, GL_UNSIGNED_INT, indices);
-	}
-
-	std::string  Shader::build_vertex_shader(int caps) {
-		std::stringstream vshad;
-
-		vshad <<
-			"uniform mat4 modelview_projection;\n"
-			"attribute vec2 v_position;\n"
-			;
-
-		if(caps & do_pretranslate)
-			vshad <<
-				"uniform vec2 pre_translation;\n"
-				;
-
-		if(caps & do_mask)
-			vshad <<
-				"varying vec2 v_maskCoord;\n"
-				;
-
-		if((caps & primary_mode_mask) == do_pattern)
-			vshad <<
-				"uniform mat4 p_projection;\n"
-				"varying vec4 p_textureCoord;\n"
-				;
-
-		if(((caps & primary_mode_mask) == do_texture)
-			||
-		   (caps & do_texture_alpha)
-			)
-			vshad <<
-				"attribute vec2 a_textureCoord;\n"
-				"uniform mat3 u_textureMatrix;\n"
-				"varying vec2 v_textureCoord;\n"
-				;
-
-		if(caps & gradient_spread_mask)
-			vshad <<
-				"varying vec2 gradient_coord;\n";
-
-		vshad <<
-			"void main() {\n"
-			;
-
-		if(caps & do_pretranslate)
-			vshad <<
-			"  gl_Position = modelview_projection * vec4(v_position + pre_translation, 0.0, 1.0);\n";
-		else
-			vshad <<
-			"  gl_Position = modelview_projection * vec4(v_position, 0.0, 1.0);\n";
-
-		if(caps & do_mask)
-			vshad <<
-				"  v_maskCoord = vec2(gl_Position.x * 0.5 + 0.5, gl_Position.y * 0.5 + 0.5);\n"
-				;
-
-		if((caps & primary_mode_mask) == do_pattern)
-			vshad <<
-				"  p_textureCoord = p_projection * vec4(gl_Position.xy, 0.0, 1.0);\n"
-				;
-
-		if(((caps & primary_mode_mask) == do_texture)
-		   ||
-		   (caps & do_texture_alpha)
-			)
-			vshad <<
-				"  vec3 atxc = u_textureMatrix * vec3(a_textureCoord, 1.0);\n"
-				"  v_textureCoord = atxc.xy;\n"
-//				"  v_textureCoord = a_textureCoord.xy;\n"
-				;
-
-		if(caps & gradient_spread_mask)
-			vshad <<
-				"  vec4 gc_tmp = surf2paint * gl_Position;\n"
-				"  gradient_coord = vec2(gc_tmp.x, gc_tmp.y);\n"
-				;
-
-
-		vshad <<
-			"}\n";
-
-		return vshad.str();
-	}
-
-	std::string Shader::build_fragment_shader(int caps) {
-		std::stringstream fshad;
-
-		bool horizontal_gauss = false;
-		bool do_gauss = false;
-
-		if(caps & do_horizontal_gaussian) {
-			horizontal_gauss = true;
-			do_gauss = true;
-		} else if(caps & do_vertical_gaussian)
-			do_gauss = true;
-
-		fshad <<
-			"precision highp float;\n"
-			;
-
-		if(caps & gradient_spread_mask)
-			fshad <<
-				"varying vec2 gradient_coord;\n";
-
-		if(caps & do_mask)
-			fshad <<
-				"varying vec2 v_maskCoord;\n"
-				"uniform sampler2D m_texture;\n";
-
-		if(caps & do_color_transform)
-			fshad <<
-				"uniform vec4 ctransform_scale;\n"
-				"uniform vec4 ctransform_bias;\n";
-
-		auto primary_mode = caps & primary_mode_mask;
-		if(primary_mode == do_linear_gradient ||
-		   primary_mode == do_radial_gradient) {
-			// gradient coordinates are in paint space - use surface2paint conversion matrix
-			fshad << "uniform mat4 surf2paint;\n";
-			fshad <<
-				"uniform vec4 stop_colors[32];\n" // stop position, R, G, B, A
-				"uniform float stop_invfactor[32];\n" // used to calculate distance between stops
-				"uniform float stop_offsets[32];\n" // stop position, R, G, B, A
-				"uniform int nr_stops;\n"       // number of active stops, max 32
-				"uniform int color_ramp_mode;\n"   // 0 = pad, 1 = repeat, 2 = mirror
-				;
-
-			if(primary_mode == do_linear_gradient) {
-				fshad <<
-					"uniform vec2 linear_normal;\n" // normal - for calculating distance in linear gradient
-					"uniform vec2 linear_start;\n"     // linear gradient (x0, y0)
-					"uniform float linear_length;\n"  // length of gradient
-					;
-			} else {
-				fshad <<
-					"uniform vec4 radial;\n"    // (focus.x, f.y, focus.x - center.x, f.y - c.y)
-					"uniform float radius2;\n"  // radius ^ 2
-					"uniform float radial_denom;\n"  // 1 / (r^2 − (fx'^2 + fy'^2))
-					;
-			}
-		} else if(primary_mode == do_pattern)
-			fshad <<
-				"varying vec4 p_textureCoord;\n"
-				"uniform sampler2D p_texture;\n";
-		else // flat color
-			fshad <<
-				"uniform vec4 v_color;\n"
-				;
-
-		if((primary_mode == do_texture) || (caps & do_texture_alpha))
-			fshad <<
-				"varying vec2 v_textureCoord;\n"
-				"uniform sampler2D u_textureSampler;\n";
-
-		if(do_gauss)
-			fshad
-				<< "uniform vec4 pxl_n_half_pxl_size;\n"
-				<< GenerateGaussFunctionCode(
-					(caps & gauss_krn_diameter_mask) >> 16,
-					true
-					)
-				;
-
-		fshad <<
-			"\n"
-			"void main() {\n";
-
-		GNUVG_ERROR("caps: %x -- gradient_spread_mask: %x -- %x\n",
-			    caps, gradient_spread_mask,
-			    caps & gradient_spread_mask);
-
-		if(caps & do_mask)
-			fshad <<
-				"  vec4 m = texture2D( m_texture, v_maskCoord );\n";
-
-		if(caps & do_texture_alpha)
-			fshad <<
-				"  vec4 t = texture2D( u_textureSampler, v_textureCoord.xy );\n";
-
-
-		switch(primary_mode) {
-		case do_flat_color:
-			fshad << "  vec4 c = v_color;\n";
-			break;
-
-		case do_linear_gradient:
-		case do_radial_gradient:
-			if(primary_mode == do_linear_gradient)
-				fshad <<
-					"  vec2 BA = gradient_coord - linear_start;\n"
-					"  float g = ((BA.x*linear_normal.y) - (BA.y*linear_normal.x)) / linear_length;\n"
-					;
-			else
-				fshad <<
-					"  vec2 dxy = coord - radial.xy;\n"
-					"  float g = dot(dxy, radial.zw);\n"
-					"  float h = dxy.x * radial.w - dxy.y * radial.z;\n"
-					"  g += sqrt(radius2 * dot(dxy, dxy) - h*h);\n"
-					"  g *= radial_denom;\n"
-					;
-
-			switch(caps & gradient_spread_mask) {
-			case do_gradient_pad:
-				fshad << "    g = clamp(g, 0.0, 1.0);\n";
-				break;
-			case do_gradient_repeat:
-				fshad << "    g = mod(g, 1.0);\n";
-				break;
-			case do_gradient_reflect:
-				fshad <<
-					"    float uneven;\n"
-					"    g = mod(g, 1.0);\n"
-					"    uneven = floor(0.6 + mod(abs(floor(g))/2.0, 1.0));\n"
-					"    g = g * (1.0 - uneven) + (1.0 - g) * uneven;\n";
-				break;
-			}
-
-			fshad <<
-				"  vec4 previous_color = vec4(0.0f, 0.0f, 0.0f, 0.0f);\n"
-				"  vec4 c = stop_colors[nr_stops - 1];\n"
-				"  for(int i = 0; i < nr_stops; i++) {\n"
-				"    if(g < stop_offsets[i]) {\n"
-				"      float coef = (stop_offsets[i] - g) * stop_invfactor[i];\n"
-				"      c = mix(stop_colors[i], previous_color, coef);\n"
-				"    }\n"
-				"    previous_color = stop_colors[i];\n"
-				"  }\n";
-			break;
-
-		case do_pattern:
-			if(do_gauss) {
-				auto hpx_size = horizontal_gauss ?
-					"pxl_n_half_pxl_size.z, 0" :
-					"0, pxl_n_half_pxl_size.w"
-					;
-				auto px_size = horizontal_gauss ?
-					"pxl_n_half_pxl_size.x, 0" :
-					"0, pxl_n_half_pxl_size.y"
-					;
-				fshad <<
-					"  vec4 c = GaussianBlur( p_texture, p_textureCoord.xy, \n"
-					"                    vec2( " << hpx_size << " ),\n"
-					"                    vec2( " <<  px_size << " ) );\n"
-					;
-			} else {
-				fshad <<
-					"  vec4 c = texture2D( p_texture, p_textureCoord.xy );\n";
-			}
-			break;
-
-		case do_texture:
-			fshad <<
-				"  vec4 c = texture2D( u_textureSampler, v_textureCoord.xy );\n";
-			break;
-		}
+		glDrawElements(GL_TRIANGLES, nr_indices, GL_UNSIGNED_SHORT, indices);
+	}
 
-		if(caps & do_mask)
-			fshad << "  c = m.a * c;\n";
+	void Shader::render_line_elements(const GLushort *indices, GLsizei nr_indices) const {
+		ADD_GNUVG_PROFILER_PROBE(SH_render_line_elements);
+		ADD_GNUVG_PROFILER_COUNTER(SH_render_line_elements, nr_indices);
 
-		if(caps & do_texture_alpha)
-			fshad << "  c = t.a * c;\n";
-//			fshad << "  c = t;\n";
+		glDrawElements(GL_LINES, nr_indices, GL_UNSIGNED_SHORT, indices);
+	}
 
-		if(caps & do_color_transform)
-			fshad <<
-				"  gl_FragColor.r = c.r * ctransform_scale.r + ctransform_bias.r;\n"
-				"  gl_FragColor.g = c.g * ctransform_scale.g + ctransform_bias.g;\n"
-				"  gl_FragColor.b = c.b * ctransform_scale.b + ctransform_bias.b;\n"
-				"  gl_FragColor.a = c.a * ctransform_scale.a + ctransform_bias.a;\n"
-				;
-		else
-			fshad <<
-				"  gl_FragColor = c;\n"
-				;
+	static void print_shader(const std::string &title, const std::string &content_s) {
+		GNUVG_ERROR("%s\n", title.c_str());
 
-		fshad <<
-			"}\n"
-			;
+		auto content = content_s.c_str();
+		std::vector<char> bfr;
+		size_t k = 0, l = 0;
 
-		return fshad.str();
+		while(content[k] != '\0') {
+			bfr.clear();
+			while(content[k] != '\n' && content[k] != '\0') {
+				bfr.push_back(content[k]);
+				k += 1;
+			}
+			bfr.push_back('\0');
+			GNUVG_ERROR("%lx: %s\n", l, bfr.data());
+			if(content[k] == '\n') k += 1;
+			l++;
+		}
 	}
 
 	static GLuint compile_shader(GLenum shader_type, const char *shader_source) {
@@ -487,6 +487,9 @@ namespace gnuVG {
 			glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
 			if(!compiled) {
 				GNUVG_ERROR("Shader program failed to compile.\n");
+				print_shader(shader_type == GL_VERTEX_SHADER ?
+					     "Vertex Shader:" : "Fragment Shader:",
+					     shader_source);
 
 				GLint infoLen = 0;
 				glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &infoLen);
@@ -541,71 +544,47 @@ namespace gnuVG {
 		return program;
 	}
 
-	static void print_shader(const std::string &title, const std::string &content_s) {
-		GNUVG_ERROR("%s\n", title.c_str());
-
-		auto content = content_s.c_str();
-		std::vector<char> bfr;
-		size_t k = 0, l = 0;
-
-		while(content[k] != '\0') {
-			bfr.clear();
-			while(content[k] != '\n' && content[k] != '\0') {
-				bfr.push_back(content[k]);
-				k += 1;
-			}
-			bfr.push_back('\0');
-			GNUVG_ERROR("%lx: %s\n", l, bfr.data());
-			if(content[k] == '\n') k += 1;
-			l++;
-		}
+	static const ShaderTableEntry* find_in_table(int caps) {
+		auto end = shader_table + shader_table_size;
+		auto found = std::lower_bound(
+			shader_table, end, caps,
+			[](const ShaderTableEntry &e, int c) { return e.caps < c; });
+		return (found != end && found->caps == caps) ? found : nullptr;
 	}
 
-	Shader::Shader(int caps) {
-		auto vertex_shader = build_vertex_shader(caps);
-		auto fragment_shader = build_fragment_shader(caps);
-
-		if(caps & do_horizontal_gaussian || caps & do_vertical_gaussian)
-			GNUVG_ERROR("Caps debug, gauss: %x\n", caps);
-
-		print_shader("Vertex Shader:", vertex_shader);
-		print_shader("Fragment Shader:", fragment_shader);
-
-		program_id = create_program(vertex_shader.c_str(),
-					    fragment_shader.c_str());
-
-		position_handle = glGetAttribLocation(program_id, "v_position");
-
-		textureCoord_handle = glGetAttribLocation(program_id, "a_textureCoord");
-		textureMatrix_handle = glGetUniformLocation(program_id, "u_textureMatrix");
-		textureSampler_handle = glGetUniformLocation(program_id, "u_textureSampler");
-
-		ColorHandle = glGetUniformLocation(program_id, "v_color");
-		Matrix = glGetUniformLocation(program_id, "modelview_projection");
-		preTranslation = glGetUniformLocation(program_id, "pre_translation");
+	GLuint Shader::build_program(int caps) {
+		if(auto entry = find_in_table(caps))
+			return create_program(entry->vertex_shader,
+					      entry->fragment_shader);
 
-		maskTexture = glGetUniformLocation(program_id , "m_texture" );
-
-		pxl_sizes = glGetUniformLocation(program_id, "pxl_n_half_pxl_size");
-		patternTexture = glGetUniformLocation(program_id , "p_texture" );
-		patternMatrix = glGetUniformLocation(program_id, "p_projection");
-
-		surf2paint = glGetUniformLocation(program_id, "surf2paint");
-
-		ctransform_scale = glGetUniformLocation(program_id, "ctransform_scale");
-		ctransform_bias = glGetUniformLocation(program_id, "ctransform_bias");
-
-		linear_normal = glGetUniformLocation(program_id, "linear_normal");
-		linear_start = glGetUniformLocation(program_id, "linear_start");
-		linear_length = glGetUniformLocation(program_id, "linear_length");
+		// see Shader::table_capabilities()
+		GNUVG_ERROR("Shader::build_program() - %x is not in the shader table\n", caps);
+		return 0;
+	}
 
-		radial = glGetUniformLocation(program_id, "radial");
-		radius2 = glGetUniformLocation(program_id, "radius2");
-		radial_denom = glGetUniformLocation(program_id, "radial_denom");
+	Shader::Shader(int _caps, GLuint program) : caps(_caps), program_id(program) {
+		std::fill(scalar_cache, scalar_cache + nr_scalar_slots,
+			  std::numeric_limits<GLfloat>::quiet_NaN());
+
+		// the table knows which handles exist, skip looking up the rest
+		auto entry = find_in_table(caps);
+		auto used = entry ? entry->handles : ~(uint64_t)0;
+		for(size_t k = 0; k < nr_handles; k++) {
+			auto &handle = this->*handle_members[k];
+			if(!(used & ((uint64_t)1 << k)))
+				handle = -1;
+			else if(handle_names[k].attribute)
+				handle = glGetAttribLocation(program_id, handle_names[k].name);
+			else
+				handle = glGetUniformLocation(program_id, handle_names[k].name);
+		}
 
-		stop_colors = glGetUniformLocation(program_id, "stop_colors");
-		stop_invfactor = glGetUniformLocation(program_id, "stop_invfactor");
-		stop_offsets = glGetUniformLocation(program_id, "stop_offsets");
-		nr_stops = glGetUniformLocation(program_id, "nr_stops");
+		if(caps == do_generic) {
+			generic_mode = glGetUniformLocation(program_id, "g_mode");
+			generic_spread = glGetUniformLocation(program_id, "g_spread");
+			for(size_t k = 0; k < nr_generic_flags; k++)
+				generic_flag_handles.push_back(
+					glGetUniformLocation(program_id, generic_flags[k].name));
+		}
 	}
 };
@@ -20,6 +20,9 @@
 #pragma once
 
 #include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
 #include <GLES2/gl2.h>
 #include <GLES2/gl2ext.h>
 
@@ -27,7 +30,11 @@ namespace gnuVG {
 	class Shader {
 	public:
 		enum Values {
-			gauss_krn_diameter_shift = 16,
+			gauss_kernel_shift = 16,
+			// a longer kernel is clamped to this diameter,
+			// which needs this many vec4 in the shader
+			max_gaussian_diameter = 255,
+			max_gaussian_pairs = 32,
 		};
 		enum Capabilities {
 			// primary mode
@@ -36,6 +43,7 @@ namespace gnuVG {
 			do_radial_gradient	= 0x00000002,
 			do_pattern		= 0x00000003,
 			do_texture		= 0x00000004,
+			do_vertex_color		= 0x00000005,
 
 			primary_mode_mask	= 0x0000000f,
 
@@ -49,13 +57,23 @@ namespace gnuVG {
 			// additional flags
 			do_mask			= 0x00000100,
 			do_pretranslate		= 0x00000200,
-			do_horizontal_gaussian	= 0x00000400,
-			do_vertical_gaussian	= 0x00000800,
+			do_gaussian		= 0x00000400,
+			do_two_stop_ramp	= 0x00000800, // gradient of two stops, mixed directly
+			do_stroke_extrusion	= 0x00001000,
+			do_nonscaling_stroke	= 0x00002000,
+			do_dash			= 0x00004000,
+			do_disc			= 0x00008000,
 			do_color_transform	= 0x01000000,
 			do_texture_alpha	= 0x02000000,
+			do_coverage		= 0x04000000,
 
-			// gaussian kernel configuration
-			gauss_krn_diameter_mask = 0x00ff0000,
+			// the generic shader, which selects the above with
+			// uniforms - drawn with while the real one compiles
+			do_generic		= 0x08000000,
+
+			// the number of vec4 in the gaussian kernel uniform,
+			// see gaussian_caps()
+			gauss_kernel_mask	= 0x00ff0000,
 		};
 
 		enum Blending {
@@ -74,52 +92,183 @@ namespace gnuVG {
 		static GLuint create_program(const char *vertexshader_source,
 					     const char *fragmentshader_source);
 
-		// returns a shader program ID number
-		static const Shader* get_shader(int capabilities);
+		/* GLSL generation, see gnuVG_shadergenerator.cc, which
+		 * only the gnuVG_shadergen tool links */
+		static std::string build_vertex_shader(int caps);
+		static std::string build_fragment_shader(int caps);
+		// the capability sets generated at build time,
+		// all that the Context asks for
+		static std::vector<int> table_capabilities();
+
+		// bit k is set when handle_names[k] is declared
+		static uint64_t used_handles(const std::string &vertex_shader,
+					     const std::string &fragment_shader);
+		struct HandleName {
+			const char *name;
+			bool attribute;
+		};
+		static const HandleName handle_names[];
+		static const size_t nr_handles;
+		// the handles named by handle_names
+		static GLint Shader::* const handle_members[];
+
+		// the features the generic shader selects with bool uniforms
+		struct NamedCapability {
+			int cap;
+			const char *name;
+		};
+		static const NamedCapability generic_flags[];
+		static const size_t nr_generic_flags;
 
-		void use_shader() const;
+		/* The shader for the capabilities, or the generic shader
+		 * while it compiles - pass the same capabilities to
+		 * use_shader().
+		 */
+		static const Shader* get_shader(int capabilities);
+		// do_gaussian and the kernel size for a kernel diameter
+		static int gaussian_caps(int diameter);
+		// create the shaders that have a binary in the ProgramCache
+		static void load_cached_programs();
+		/* Compile the table capability sets with a primary mode k
+		 * where bit (1 << k) is set in primary_modes, and no other
+		 * bits than those in flags. Now, or queued for the
+		 * ShaderCompiler when it runs.
+		 */
+		static void precompile(int primary_modes, int flags);
+		// used by the ShaderCompiler thread
+		static GLuint load_or_build_program(int capabilities);
+
+		// the generic shader selects the capabilities to draw with
+		void use_shader(int capabilities) const;
 
 		void set_blending(Blending bmode) const;
 
-		void set_matrix(const GLfloat *mtrx) const;
+		/* Setters taking a version skip the upload when the
+		 * shader already got that version, 0 always uploads.
+		 */
+		void set_matrix(const GLfloat *mtrx, GLuint version = 0) const;
 		void set_pre_translation(const GLfloat *ptrans) const;
 
-		void set_surf2paint_matrix(const GLfloat *s2p_matrix) const;
+		void set_surf2paint_matrix(const GLfloat *s2p_matrix, GLuint version = 0) const;
 
 		void set_mask_texture(GLuint tex) const;
 
-		void set_pattern_size(GLint width_in_pixels, GLint height_in_pixels) const;
 		void set_pattern_matrix(const GLfloat *mtrx) const;
 		void set_pattern_texture(GLuint tex) const;
-		void set_wrap_mode(GLuint wrap_mode) const;
+		// blur along (step_x, step_y), one texel in texture coordinates
+		void set_gaussian_kernel(int diameter, GLfloat step_x, GLfloat step_y) const;
 
 		void set_color_transform(const GLfloat *scale,
 					 const GLfloat *bias) const;
 
-		void set_color(const GLfloat *clr) const;
-		void set_linear_parameters(const GLfloat *vec) const;
-		void set_radial_parameters(const GLfloat *vec) const;
-		void set_color_ramp(GLuint max_stops,
-				    const GLfloat *offsets,
-				    const GLfloat *invfactor,
-				    const GLfloat *colors) const;
+		void set_color(const GLfloat *clr, GLuint version = 0) const;
+		void set_linear_parameters(const GLfloat *vec, GLuint version = 0) const;
+		void set_radial_parameters(const GLfloat *vec, GLuint version = 0) const;
+		// the ColorRampAtlas texture and the row of the ramp
+		void set_color_ramp(GLuint texture, GLfloat row) const;
+		// the first two stops of a paint, for do_two_stop_ramp
+		void set_two_stop_ramp(const GLfloat *offsets,
+				       const GLfloat *invfactor,
+				       const GLfloat *colors,
+				       GLuint version = 0) const;
 
 		void load_2dvertex_array(const GLfloat *verts, GLint stride) const;
 		void load_2dvertex_texture_array(const GLfloat *verts, GLint stride) const;
+		void load_vertex_color_array(const GLfloat *colors, GLint stride) const;
+		void load_extrusion_array(const GLfloat *extrusions, GLint stride) const;
+		void set_stroke_width(GLfloat width) const;
+		void set_viewport_size(GLint width_in_pixels, GLint height_in_pixels) const;
+		void load_arc_length_array(const GLfloat *arc_lengths, GLint stride) const;
+		void load_disc_array(const GLfloat *disc_flags, GLint stride) const;
+		void load_side_array(const GLfloat *sides, GLint stride) const;
+		void set_stroke_half_width(GLfloat half_width_in_pixels) const;
+		void load_coverage_array(const GLfloat *coverage, GLint stride) const;
+		void set_full_coverage() const;
+		void set_dash_pattern(const GLfloat *dash_ends, GLint nr_dashes,
+				      GLfloat phase) const;
 		void set_texture(GLuint tex) const;
 		void set_texture_matrix(const GLfloat *mtrx_3by3) const;
 		void render_triangles(GLint first, GLsizei count) const;
-		void render_elements(const GLuint *indices, GLsizei nr_indices) const;
+		void render_elements(const GLushort *indices, GLsizei nr_indices) const;
+		void render_line_elements(const GLushort *indices, GLsizei nr_indices) const;
 
 	private:
 		static std::map<int, Shader*> shader_library;
+		static void adopt_compiled_programs();
 
 		GLfloat pixel_width, pixel_height;
 
+		int caps;
 		GLuint program_id;
 
+		// the capabilities last uploaded to the generic uniforms
+		mutable int selected_generic_caps = -1;
+		GLint generic_mode, generic_spread;
+		std::vector<GLint> generic_flag_handles;
+		void select_generic_features(int generic_caps) const;
+
+		/* Last values uploaded by the setters without a version,
+		 * uniforms live in the program so they survive switching
+		 * between shaders. A slot per uniform, scalars start as
+		 * NaN and vectors empty so the first upload goes through.
+		 */
+		enum ScalarSlot {
+			scalar_mask_texture,
+			scalar_pattern_texture,
+			scalar_texture_sampler,
+			scalar_ramp_texture,
+			scalar_ramp_row,
+			scalar_stroke_width,
+			scalar_half_width,
+			scalar_nr_dashes,
+			scalar_dash_period,
+			scalar_dash_phase,
+			scalar_gauss_diameter, // the kernel and its pairs follow it
+			nr_scalar_slots
+		};
+		enum VectorSlot {
+			vector_pre_translation,
+			vector_gauss_step,
+			vector_pattern_matrix,
+			vector_ctransform_scale,
+			vector_ctransform_bias,
+			vector_viewport_half,
+			vector_dash_ends,
+			vector_texture_matrix,
+			nr_vector_slots
+		};
+		struct CachedVector {
+			GLsizei count = 0;
+			GLfloat values[16]; // a mat4, or the GPU dashes
+		};
+		mutable GLfloat scalar_cache[nr_scalar_slots];
+		mutable CachedVector vector_cache[nr_vector_slots];
+		bool scalar_changed(ScalarSlot slot, GLint location, GLfloat value) const;
+		bool vector_changed(VectorSlot slot, GLint location,
+				    const GLfloat *values, GLsizei count) const;
+		void set_uniform1f(ScalarSlot slot, GLint location, GLfloat value) const;
+		void set_uniform1i(ScalarSlot slot, GLint location, GLint value) const;
+
+		// the versions of the data last uploaded by the versioned setters
+		enum VersionSlot {
+			version_matrix,
+			version_surf2paint,
+			version_color,
+			version_gradient,
+			version_color_ramp,
+			nr_version_slots
+		};
+		mutable GLuint uploaded_version[nr_version_slots] = {};
+		bool version_changed(VersionSlot slot, GLuint version) const;
+
 		/* shader handles */
 		GLint position_handle;
+		GLint color_handle;
+		GLint extrusion_handle;
+		GLint arc_length_handle;
+		GLint disc_handle;
+		GLint side_handle;
+		GLint coverage_handle;
 
 		GLint textureCoord_handle;
 		GLint textureMatrix_handle;
@@ -128,10 +277,13 @@ namespace gnuVG {
 		GLint ColorHandle;
 		GLint Matrix;
 		GLint preTranslation;
+		GLint strokeWidth, viewportHalf;
+		GLint dashEnds, nrDashes, dashPeriod, dashPhase;
+		GLint halfWidthPixels;
 
 		GLint maskTexture;
 
-		GLint pxl_sizes;
+		GLint gaussKernel, gaussPairs, gaussStep;
 		GLint patternTexture, patternMatrix;
 
 		GLint surf2paint;
@@ -146,14 +298,13 @@ namespace gnuVG {
 		GLint radius2;
 		GLint radial_denom;
 
-		GLint stop_colors;
-		GLint stop_invfactor;
-		GLint stop_offsets;
-		GLint nr_stops;
+		GLint rampTexture, rampRow;
+		GLint rampStart, rampEnd, rampSpan;
 
-		Shader(int caps);
+		Shader(int caps, GLuint program);
 
-		std::string build_vertex_shader(int caps);
-		std::string build_fragment_shader(int caps);
+		static GLuint build_program(int caps);
+		static std::string build_generic_vertex_shader();
+		static std::string build_generic_fragment_shader();
 	};
 };
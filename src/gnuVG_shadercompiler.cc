@@ -0,0 +1,110 @@
+/*
+ * gnuVG - a free Vector Graphics library
+ * Copyright (C) 2016 by Anton Persson
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "gnuVG_shadercompiler.hh"
+#include "gnuVG_shader.hh"
+
+//#define __DO_GNUVG_DEBUG
+#include "gnuVG_debug.hh"
+
+namespace gnuVG {
+
+	std::thread ShaderCompiler::worker;
+	std::mutex ShaderCompiler::lock;
+	std::condition_variable ShaderCompiler::wakeup;
+	bool ShaderCompiler::quit = false;
+
+	std::deque<int> ShaderCompiler::queue;
+	std::set<int> ShaderCompiler::requested;
+	std::vector<std::pair<int, GLuint> > ShaderCompiler::finished;
+
+	void ShaderCompiler::start(BindContext bind_context, void *user_data) {
+		stop();
+
+		quit = false;
+		worker = std::thread(run, bind_context, user_data);
+	}
+
+	void ShaderCompiler::stop() {
+		if(!worker.joinable())
+			return;
+
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			quit = true;
+		}
+		wakeup.notify_one();
+		worker.join();
+
+		// programs nobody collected are still valid, but the
+		// requests that never started must be made again
+		for(auto caps : queue)
+			requested.erase(caps);
+		queue.clear();
+	}
+
+	bool ShaderCompiler::is_running() {
+		return worker.joinable();
+	}
+
+	void ShaderCompiler::request(int caps) {
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			if(!requested.insert(caps).second)
+				return;
+			queue.push_back(caps);
+		}
+		wakeup.notify_one();
+	}
+
+	void ShaderCompiler::collect(std::vector<std::pair<int, GLuint> > &programs) {
+		std::lock_guard<std::mutex> guard(lock);
+		programs.insert(programs.end(), finished.begin(), finished.end());
+		finished.clear();
+	}
+
+	void ShaderCompiler::run(BindContext bind_context, void *user_data) {
+		bind_context(user_data, VG_TRUE);
+
+		while(true) {
+			int caps;
+			{
+				std::unique_lock<std::mutex> guard(lock);
+				wakeup.wait(guard, [] { return quit || !queue.empty(); });
+				if(quit)
+					break;
+				caps = queue.front();
+				queue.pop_front();
+			}
+
+			GNUVG_DEBUG("ShaderCompiler - compiling %x\n", caps);
+			auto program = Shader::load_or_build_program(caps);
+
+			// the program must be complete before another
+			// context starts using it
+			glFinish();
+
+			std::lock_guard<std::mutex> guard(lock);
+			finished.push_back(std::make_pair(caps, program));
+		}
+
+		bind_context(user_data, VG_FALSE);
+	}
+
+};
@@ -0,0 +1,65 @@
+/*
+ * gnuVG - a free Vector Graphics library
+ * Copyright (C) 2016 by Anton Persson
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+#include <condition_variable>
+#include <GLES2/gl2.h>
+#include <VG/openvg.h>
+
+namespace gnuVG {
+
+	/* Compiles shader programs on a background thread. The
+	 * thread renders nothing, it only needs a GL context that
+	 * shares objects with the rendering contexts - the application
+	 * creates that and binds it through the callback.
+	 */
+	class ShaderCompiler {
+	public:
+		typedef gnuVGBindContextCallback BindContext;
+
+		static void start(BindContext bind_context, void *user_data);
+		static void stop();
+		static bool is_running();
+
+		// queue caps unless it is already queued or done
+		static void request(int caps);
+
+		// hand over the programs finished since the last call
+		static void collect(std::vector<std::pair<int, GLuint> > &programs);
+
+	private:
+		static std::thread worker;
+		static std::mutex lock;
+		static std::condition_variable wakeup;
+		static bool quit;
+
+		static std::deque<int> queue;
+		static std::set<int> requested;
+		static std::vector<std::pair<int, GLuint> > finished;
+
+		static void run(BindContext bind_context, void *user_data);
+	};
+
+};
@@ -0,0 +1,126 @@
+/*
+ * gnuVG - a free Vector Graphics library
+ * Copyright (C) 2016 by Anton Persson
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Writes the ShaderTable, the GLSL for every capability set in
+ * Shader::table_capabilities(), to the file given as argument.
+ */
+
+#include <stdio.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include "gnuVG_shader.hh"
+
+using namespace gnuVG;
+
+// a C string literal, one line of GLSL per line of C
+static void write_literal(FILE *out, const std::string &source) {
+	fprintf(out, "\t\"");
+	for(size_t k = 0; k < source.size(); k++) {
+		unsigned char c = source[k];
+		if(c == '\n') {
+			fprintf(out, k + 1 < source.size() ? "\\n\"\n\t\"" : "\\n");
+		} else if(c == '"' || c == '\\') {
+			fprintf(out, "\\%c", c);
+		} else if(c < 0x20 || c >= 0x7f) {
+			fprintf(out, "\\%03o", c);
+		} else {
+			fputc(c, out);
+		}
+	}
+	fprintf(out, "\";\n\n");
+}
+
+int main(int argc, char **argv) {
+	if(argc != 2) {
+		fprintf(stderr, "usage: %s <output.cc>\n", argv[0]);
+		return 1;
+	}
+
+	auto capabilities = Shader::table_capabilities();
+	std::sort(capabilities.begin(), capabilities.end());
+	if(std::adjacent_find(capabilities.begin(), capabilities.end()) !=
+	   capabilities.end()) {
+		fprintf(stderr, "%s: duplicated capability set\n", argv[0]);
+		return 1;
+	}
+
+	// many capability sets share a vertex shader
+	std::map<std::string, size_t> source_index;
+	std::vector<std::string> sources;
+	auto add_source = [&](const std::string &source) {
+		auto found = source_index.find(source);
+		if(found != source_index.end())
+			return found->second;
+		sources.push_back(source);
+		return source_index[source] = sources.size() - 1;
+	};
+
+	struct Entry {
+		int caps;
+		size_t vertex, fragment;
+		uint64_t handles;
+	};
+	std::vector<Entry> entries;
+	for(auto caps : capabilities) {
+		auto vertex = Shader::build_vertex_shader(caps);
+		auto fragment = Shader::build_fragment_shader(caps);
+		entries.push_back({caps, add_source(vertex), add_source(fragment),
+					Shader::used_handles(vertex, fragment)});
+	}
+
+	auto out = fopen(argv[1], "w");
+	if(!out) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	fprintf(out,
+		"// generated by gnuVG_shadergen - do not edit\n"
+		"\n"
+		"#include \"gnuVG_shadertable.hh\"\n"
+		"\n"
+		"namespace gnuVG {\n"
+		"\n");
+
+	for(size_t k = 0; k < sources.size(); k++) {
+		fprintf(out, "static constexpr char source_%zu[] =\n", k);
+		write_literal(out, sources[k]);
+	}
+
+	fprintf(out, "const ShaderTableEntry shader_table[] = {\n");
+	for(auto &e : entries)
+		fprintf(out, "\t{ 0x%08x, source_%zu, source_%zu, 0x%016llxull },\n",
+			e.caps, e.vertex, e.fragment, (unsigned long long)e.handles);
+	fprintf(out,
+		"};\n"
+		"\n"
+		"const size_t shader_table_size = %zu;\n"
+		"\n"
+		"};\n", entries.size());
+
+	if(fclose(out) != 0) {
+		perror(argv[1]);
+		remove(argv[1]);
+		return 1;
+	}
+
+	return 0;
+}
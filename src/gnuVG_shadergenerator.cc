@@ -0,0 +1,713 @@
+/*
+ * gnuVG - a free Vector Graphics library
+ * Copyright (C) 2016 by Anton Persson
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* The GLSL generator, linked into the gnuVG_shadergen tool which
+ * writes the ShaderTable at build time. The library only uses the
+ * table, it holds every capability set the Context asks for.
+ */
+
+#include <sstream>
+#include "gnuVG_shader.hh"
+#include "gnuVG_config.hh"
+
+//#define __DO_GNUVG_DEBUG
+#include "gnuVG_debug.hh"
+
+// for putting configuration values into GLSL
+#define GNUVG_STR_(x) #x
+#define GNUVG_STR(x) GNUVG_STR_(x)
+
+namespace gnuVG {
+	uint64_t Shader::used_handles(const std::string &vertex_shader,
+				      const std::string &fragment_shader) {
+		uint64_t used = 0;
+		for(size_t k = 0; k < nr_handles; k++) {
+			// declarations end with the name, or the array size
+			std::string name = std::string(" ") + handle_names[k].name;
+			for(auto source : {&vertex_shader, &fragment_shader})
+				if(source->find(name + ";") != std::string::npos ||
+				   source->find(name + "[") != std::string::npos)
+					used |= (uint64_t)1 << k;
+		}
+		return used;
+	}
+
+	std::vector<int> Shader::table_capabilities() {
+		std::vector<int> retval;
+
+		// images
+		for(auto ctransform : {0, (int)do_color_transform}) {
+			retval.push_back(do_pattern | ctransform);
+			for(int size = 2; size <= max_gaussian_pairs; size *= 2)
+				retval.push_back(do_pattern | ctransform | do_gaussian |
+						 (size << gauss_kernel_shift));
+			retval.push_back(do_flat_color | ctransform);
+			retval.push_back(do_flat_color | ctransform | do_texture_alpha);
+		}
+
+		// batched flat colors, see gnuVG_BATCH_FLAT_COLORS
+		for(auto mask : {0, (int)do_mask})
+			for(auto ctransform : {0, (int)do_color_transform})
+				retval.push_back(do_vertex_color | mask | ctransform);
+
+		// paths, see Context::use_pipeline()
+		std::vector<int> paints = { do_flat_color, do_pattern };
+		for(auto gradient : {do_linear_gradient, do_radial_gradient})
+			for(auto spread : {do_gradient_pad, do_gradient_repeat, do_gradient_reflect})
+				for(auto two_stop : {0, (int)do_two_stop_ramp})
+					paints.push_back(gradient | spread | two_stop);
+
+		std::vector<int> strokes = { 0 };
+		for(auto nonscaling : {0, (int)do_nonscaling_stroke})
+			for(auto dash : {0, (int)do_dash})
+				for(auto disc : {0, (int)do_disc})
+					strokes.push_back(do_stroke_extrusion | nonscaling | dash | disc);
+
+		for(auto paint : paints)
+			for(auto mask : {0, (int)do_mask})
+				for(auto ctransform : {0, (int)do_color_transform})
+					for(auto coverage : {0, (int)do_coverage})
+						for(auto stroke : strokes)
+							retval.push_back(do_pretranslate | paint | mask |
+									 ctransform | coverage | stroke);
+
+		retval.push_back(do_generic);
+
+		return retval;
+	}
+
+	/* GLSL shared by the gradient shaders and the generic shader,
+	 * which computes g from gradient_coord and then the color c.
+	 */
+	static const char *color_ramp_uniforms =
+		"uniform sampler2D ramp_texture;\n" // the ColorRampAtlas
+		"uniform float ramp_row;\n"         // v of the row with our ramp
+		;
+
+	static const char *two_stop_ramp_uniforms =
+		"uniform vec4 ramp_start;\n" // color of the first stop
+		"uniform vec4 ramp_end;\n"   // color of the second stop
+		"uniform vec2 ramp_span;\n"  // (first offset, 1 / distance to the second)
+		;
+
+	static const char *linear_gradient_uniforms =
+		"uniform vec2 linear_normal;\n" // normal - for calculating distance in linear gradient
+		"uniform vec2 linear_start;\n"     // linear gradient (x0, y0)
+		"uniform float linear_length;\n"  // length of gradient
+		;
+
+	static const char *radial_gradient_uniforms =
+		"uniform vec4 radial;\n"    // (focus.x, f.y, focus.x - center.x, f.y - c.y)
+		"uniform float radius2;\n"  // radius ^ 2
+		"uniform float radial_denom;\n"  // 1 / (r^2 − (fx'^2 + fy'^2))
+		;
+
+	static const char *linear_gradient_code =
+		"  vec2 BA = gradient_coord - linear_start;\n"
+		"  g = ((BA.x*linear_normal.y) - (BA.y*linear_normal.x)) / linear_length;\n"
+		;
+
+	static const char *radial_gradient_code =
+		"  vec2 dxy = gradient_coord - radial.xy;\n"
+		"  g = dot(dxy, radial.zw);\n"
+		"  float h = dxy.x * radial.w - dxy.y * radial.z;\n"
+		"  g += sqrt(radius2 * dot(dxy, dxy) - h*h);\n"
+		"  g *= radial_denom;\n"
+		;
+
+	static const char *pad_spread_code =
+		"  g = clamp(g, 0.0, 1.0);\n";
+	static const char *repeat_spread_code =
+		"  g = fract(g);\n";
+	static const char *reflect_spread_code =
+		"  g = 1.0 - abs(mod(g, 2.0) - 1.0);\n";
+
+	// the ramp is baked from g = 0.0 at the first texel
+	// centre to g = 1.0 at the last
+	static const char *color_ramp_code =
+		"  float ramp_width = " GNUVG_STR(GNUVG_COLOR_RAMP_WIDTH) ".0;\n"
+		"  c = texture2D(ramp_texture,\n"
+		"                vec2((g * (ramp_width - 1.0) + 0.5) / ramp_width, ramp_row));\n";
+
+	static const char *two_stop_ramp_code =
+		"  c = clamp(mix(ramp_start, ramp_end,\n"
+		"                clamp((g - ramp_span.x) * ramp_span.y, 0.0, 1.0)),\n"
+		"            0.0, 1.0);\n";
+
+	std::string Shader::build_vertex_shader(int caps) {
+		if(caps == do_generic)
+			return build_generic_vertex_shader();
+
+		std::stringstream vshad;
+
+		vshad <<
+			"uniform mat4 modelview_projection;\n"
+			"attribute vec2 v_position;\n"
+			;
+
+		if(caps & do_pretranslate)
+			vshad <<
+				"uniform vec2 pre_translation;\n"
+				;
+
+		if(caps & do_stroke_extrusion)
+			vshad <<
+				"attribute vec2 a_extrusion;\n" // extrusion for a stroke width of one
+				"uniform float stroke_width;\n"
+				;
+
+		if(caps & do_nonscaling_stroke)
+			vshad <<
+				"uniform vec2 viewport_half;\n" // pixels per unit of OpenGL space
+				;
+
+		if(caps & do_dash)
+			vshad <<
+				"attribute float a_arcLength;\n"
+				"varying float v_arcLength;\n"
+				;
+
+		if(caps & do_disc)
+			vshad <<
+				"attribute float a_disc;\n"
+				"varying vec2 v_disc;\n" // inside the unit circle is covered
+				;
+
+		bool stroke_coverage = (caps & do_coverage) && (caps & do_stroke_extrusion);
+		if(stroke_coverage)
+			vshad <<
+				"attribute float a_side;\n"
+				"uniform float half_width_px;\n"
+				"varying vec2 v_edge;\n" // (pixels from the centerline, half width + 0.5)
+				;
+		else if(caps & do_coverage)
+			vshad <<
+				"attribute float a_coverage;\n"
+				"varying float v_coverage;\n"
+				;
+
+		if(caps & do_mask)
+			vshad <<
+				"varying vec2 v_maskCoord;\n"
+				;
+
+		if((caps & primary_mode_mask) == do_pattern)
+			vshad <<
+				"uniform mat4 p_projection;\n"
+				"varying vec4 p_textureCoord;\n"
+				;
+
+		if(((caps & primary_mode_mask) == do_texture)
+			||
+		   (caps & do_texture_alpha)
+			)
+			vshad <<
+				"attribute vec2 a_textureCoord;\n"
+				"uniform mat3 u_textureMatrix;\n"
+				"varying vec2 v_textureCoord;\n"
+				;
+
+		if(caps & gradient_spread_mask)
+			vshad <<
+				"uniform mat4 surf2paint;\n"
+				"varying vec2 gradient_coord;\n";
+
+		if((caps & primary_mode_mask) == do_vertex_color)
+			vshad <<
+				"attribute vec4 a_color;\n"
+				"varying vec4 v_vertexColor;\n"
+				;
+
+		vshad <<
+			"void main() {\n"
+			;
+
+		vshad <<
+			"  vec2 position = v_position;\n";
+
+		// the outline grows by a pixel, which becomes the fringe
+		auto grow = stroke_coverage ? " * grow" : "";
+		if(stroke_coverage)
+			vshad <<
+				"  float grow = 1.0 + 1.0 / half_width_px;\n";
+
+		if(caps & do_pretranslate)
+			vshad <<
+				"  position += pre_translation;\n";
+
+		if((caps & do_stroke_extrusion) && !(caps & do_nonscaling_stroke))
+			vshad <<
+				"  position += a_extrusion * stroke_width" << grow << ";\n";
+
+		vshad <<
+			"  gl_Position = modelview_projection * vec4(position, 0.0, 1.0);\n";
+
+		if((caps & do_stroke_extrusion) && (caps & do_nonscaling_stroke))
+			// transform the extrusion direction, but keep its length in pixels
+			vshad <<
+				"  vec2 extrusion = (modelview_projection * vec4(a_extrusion, 0.0, 0.0)).xy;\n"
+				"  float extrusion_pixels = length(extrusion * viewport_half);\n"
+				"  if(extrusion_pixels > 0.0)\n"
+				"    gl_Position.xy += extrusion * (stroke_width * length(a_extrusion) / extrusion_pixels)" << grow << ";\n";
+
+		if(caps & do_mask)
+			vshad <<
+				"  v_maskCoord = vec2(gl_Position.x * 0.5 + 0.5, gl_Position.y * 0.5 + 0.5);\n"
+				;
+
+		if((caps & primary_mode_mask) == do_pattern)
+			vshad <<
+				"  p_textureCoord = p_projection * vec4(gl_Position.xy, 0.0, 1.0);\n"
+				;
+
+		if(((caps & primary_mode_mask) == do_texture)
+		   ||
+		   (caps & do_texture_alpha)
+			)
+			vshad <<
+				"  vec3 atxc = u_textureMatrix * vec3(a_textureCoord, 1.0);\n"
+				"  v_textureCoord = atxc.xy;\n"
+//				"  v_textureCoord = a_textureCoord.xy;\n"
+				;
+
+		if(caps & gradient_spread_mask)
+			vshad <<
+				"  vec4 gc_tmp = surf2paint * gl_Position;\n"
+				"  gradient_coord = vec2(gc_tmp.x, gc_tmp.y);\n"
+				;
+
+		if((caps & primary_mode_mask) == do_vertex_color)
+			vshad <<
+				"  v_vertexColor = a_color;\n"
+				;
+
+		if(caps & do_dash)
+			vshad <<
+				"  v_arcLength = a_arcLength;\n"
+				;
+
+		if(caps & do_disc)
+			vshad <<
+				"  v_disc = a_disc * 2.0 * a_extrusion" << grow << ";\n"
+				;
+
+		if(stroke_coverage)
+			vshad <<
+				"  v_edge = vec2(a_side * (half_width_px + 1.0), half_width_px + 0.5);\n"
+				;
+		else if(caps & do_coverage)
+			vshad <<
+				"  v_coverage = a_coverage;\n"
+				;
+
+		vshad <<
+			"}\n";
+
+		return vshad.str();
+	}
+
+	std::string Shader::build_fragment_shader(int caps) {
+		if(caps == do_generic)
+			return build_generic_fragment_shader();
+
+		std::stringstream fshad;
+
+		bool do_gauss = caps & do_gaussian;
+		auto gauss_kernel_size = (caps & gauss_kernel_mask) >> gauss_kernel_shift;
+
+		fshad <<
+			"precision highp float;\n"
+			;
+
+		if(caps & gradient_spread_mask)
+			fshad <<
+				"varying vec2 gradient_coord;\n";
+
+		if(caps & do_mask)
+			fshad <<
+				"varying vec2 v_maskCoord;\n"
+				"uniform sampler2D m_texture;\n";
+
+		if(caps & do_color_transform)
+			fshad <<
+				"uniform vec4 ctransform_scale;\n"
+				"uniform vec4 ctransform_bias;\n";
+
+		if(caps & do_dash)
+			fshad <<
+				"varying float v_arcLength;\n"
+				"uniform float dash_ends[" << GNUVG_MAX_GPU_DASHES << "];\n" // where each dash ends, the last is the period
+				"uniform int nr_dashes;\n"       // even number of active dashes
+				"uniform float dash_period;\n"
+				"uniform float dash_phase;\n"
+				;
+
+		if(caps & do_disc)
+			fshad <<
+				"varying vec2 v_disc;\n"
+				;
+
+		bool stroke_coverage = (caps & do_coverage) && (caps & do_stroke_extrusion);
+		if(stroke_coverage)
+			fshad <<
+				"varying vec2 v_edge;\n"
+				;
+		else if(caps & do_coverage)
+			fshad <<
+				"varying float v_coverage;\n"
+				;
+
+		auto primary_mode = caps & primary_mode_mask;
+		if(primary_mode == do_linear_gradient ||
+		   primary_mode == do_radial_gradient) {
+			fshad << ((caps & do_two_stop_ramp) ?
+				  two_stop_ramp_uniforms : color_ramp_uniforms);
+
+			if(primary_mode == do_linear_gradient)
+				fshad << linear_gradient_uniforms;
+			else
+				fshad << radial_gradient_uniforms;
+		} else if(primary_mode == do_pattern)
+			fshad <<
+				"varying vec4 p_textureCoord;\n"
+				"uniform sampler2D p_texture;\n";
+		else if(primary_mode == do_vertex_color)
+			fshad <<
+				"varying vec4 v_vertexColor;\n"
+				;
+		else // flat color
+			fshad <<
+				"uniform vec4 v_color;\n"
+				;
+
+		if((primary_mode == do_texture) || (caps & do_texture_alpha))
+			fshad <<
+				"varying vec2 v_textureCoord;\n"
+				"uniform sampler2D u_textureSampler;\n";
+
+		if(do_gauss)
+			fshad <<
+				"uniform vec4 gauss_kernel[" << gauss_kernel_size << "];\n" // (weight, offset) of two samples
+				"uniform int gauss_pairs;\n"  // the vec4 in use
+				"uniform vec2 gauss_step;\n"  // one texel along the blur
+				;
+
+		fshad <<
+			"\n"
+			"void main() {\n";
+
+		GNUVG_DEBUG("caps: %x -- gradient_spread_mask: %x -- %x\n",
+			    caps, gradient_spread_mask,
+			    caps & gradient_spread_mask);
+
+		if(caps & do_dash)
+			// count the dashes that ended before us, uneven means OFF
+			fshad <<
+				"  float d = mod(v_arcLength + dash_phase, dash_period);\n"
+				"  float dashes_passed = 0.0;\n"
+				"  for(int i = 0; i < " << GNUVG_MAX_GPU_DASHES << "; i++) {\n"
+				"    if(i >= nr_dashes) break;\n"
+				"    if(d >= dash_ends[i]) dashes_passed += 1.0;\n"
+				"  }\n"
+				"  if(mod(dashes_passed, 2.0) >= 1.0) discard;\n";
+
+		if(stroke_coverage) {
+			// the edge is half a pixel into the fringe
+			fshad <<
+				"  float coverage = clamp(v_edge.y - abs(v_edge.x), 0.0, 1.0);\n";
+			if(caps & do_disc)
+				fshad <<
+					"  coverage = min(coverage, clamp((1.0 - length(v_disc)) * (v_edge.y - 0.5) + 0.5, 0.0, 1.0));\n";
+		} else if(caps & do_coverage)
+			fshad <<
+				"  float coverage = v_coverage;\n";
+		else if(caps & do_disc)
+			fshad <<
+				"  if(dot(v_disc, v_disc) > 1.0) discard;\n";
+
+		if(caps & do_mask)
+			fshad <<
+				"  vec4 m = texture2D( m_texture, v_maskCoord );\n";
+
+		if(caps & do_texture_alpha)
+			fshad <<
+				"  vec4 t = texture2D( u_textureSampler, v_textureCoord.xy );\n";
+
+
+		switch(primary_mode) {
+		case do_flat_color:
+			fshad << "  vec4 c = v_color;\n";
+			break;
+
+		case do_linear_gradient:
+		case do_radial_gradient:
+			fshad <<
+				"  float g;\n"
+				"  vec4 c;\n"
+				<< (primary_mode == do_linear_gradient ?
+				    linear_gradient_code : radial_gradient_code);
+
+			switch(caps & gradient_spread_mask) {
+			case do_gradient_pad:
+				fshad << pad_spread_code;
+				break;
+			case do_gradient_repeat:
+				fshad << repeat_spread_code;
+				break;
+			case do_gradient_reflect:
+				fshad << reflect_spread_code;
+				break;
+			}
+
+			fshad << ((caps & do_two_stop_ramp) ?
+				  two_stop_ramp_code : color_ramp_code);
+			break;
+
+		case do_pattern:
+			if(do_gauss) {
+				// each sample reads two texels through linear filtering
+				fshad <<
+					"  vec4 c = vec4(0.0);\n"
+					"  vec2 centre = p_textureCoord.xy;\n"
+					"  for(int i = 0; i < " << gauss_kernel_size << "; i++) {\n"
+					"    if(i >= gauss_pairs) break;\n"
+					"    vec4 k = gauss_kernel[i];\n"
+					"    c += k.x * (texture2D(p_texture, centre + k.y * gauss_step) +\n"
+					"                texture2D(p_texture, centre - k.y * gauss_step));\n"
+					"    c += k.z * (texture2D(p_texture, centre + k.w * gauss_step) +\n"
+					"                texture2D(p_texture, centre - k.w * gauss_step));\n"
+					"  }\n"
+					;
+			} else {
+				fshad <<
+					"  vec4 c = texture2D( p_texture, p_textureCoord.xy );\n";
+			}
+			break;
+
+		case do_texture:
+			fshad <<
+				"  vec4 c = texture2D( u_textureSampler, v_textureCoord.xy );\n";
+			break;
+
+		case do_vertex_color:
+			fshad << "  vec4 c = v_vertexColor;\n";
+			break;
+		}
+
+		if(caps & do_mask)
+			fshad << "  c = m.r * c;\n";
+
+		if(caps & do_texture_alpha)
+			fshad << "  c = t.r * c;\n";
+//			fshad << "  c = t;\n";
+
+		if(caps & do_color_transform)
+			fshad <<
+				"  gl_FragColor.r = c.r * ctransform_scale.r + ctransform_bias.r;\n"
+				"  gl_FragColor.g = c.g * ctransform_scale.g + ctransform_bias.g;\n"
+				"  gl_FragColor.b = c.b * ctransform_scale.b + ctransform_bias.b;\n"
+				"  gl_FragColor.a = c.a * ctransform_scale.a + ctransform_bias.a;\n"
+				;
+		else
+			fshad <<
+				"  gl_FragColor = c;\n"
+				;
+
+		if(caps & do_coverage)
+			fshad <<
+				"  gl_FragColor.a *= coverage;\n"
+				;
+
+		fshad <<
+			"}\n"
+			;
+
+		return fshad.str();
+	}
+
+	static void add_generic_flags(std::stringstream &shad) {
+		for(size_t k = 0; k < Shader::nr_generic_flags; k++)
+			shad << "uniform bool " << Shader::generic_flags[k].name << ";\n";
+	}
+
+	/* The generic shader does what build_vertex_shader() and
+	 * build_fragment_shader() generate for any capabilities except
+	 * the gaussian blur, picking the features with uniforms.
+	 */
+	std::string Shader::build_generic_vertex_shader() {
+		std::stringstream vshad;
+
+		add_generic_flags(vshad);
+		vshad <<
+			"uniform mat4 modelview_projection;\n"
+			"uniform vec2 pre_translation;\n"
+			"uniform float stroke_width;\n"
+			"uniform vec2 viewport_half;\n"
+			"uniform float half_width_px;\n"
+			"uniform mat4 p_projection;\n"
+			"uniform mat3 u_textureMatrix;\n"
+			"uniform mat4 surf2paint;\n"
+
+			"attribute vec2 v_position;\n"
+			"attribute vec4 a_color;\n"
+			"attribute vec2 a_extrusion;\n"
+			"attribute float a_arcLength;\n"
+			"attribute float a_disc;\n"
+			"attribute float a_side;\n"
+			"attribute float a_coverage;\n"
+			"attribute vec2 a_textureCoord;\n"
+
+			"varying vec2 v_maskCoord;\n"
+			"varying vec4 p_textureCoord;\n"
+			"varying vec2 v_textureCoord;\n"
+			"varying vec2 gradient_coord;\n"
+			"varying vec4 v_vertexColor;\n"
+			"varying float v_arcLength;\n"
+			"varying vec2 v_disc;\n"
+			"varying vec2 v_edge;\n"
+			"varying float v_coverage;\n"
+
+			"void main() {\n"
+			"  vec2 position = v_position;\n"
+			"  bool stroke_coverage = g_coverage && g_stroke_extrusion;\n"
+			"  float grow = stroke_coverage ? 1.0 + 1.0 / half_width_px : 1.0;\n"
+			"  if(g_pretranslate)\n"
+			"    position += pre_translation;\n"
+			"  if(g_stroke_extrusion && !g_nonscaling_stroke)\n"
+			"    position += a_extrusion * stroke_width * grow;\n"
+			"  gl_Position = modelview_projection * vec4(position, 0.0, 1.0);\n"
+			"  if(g_stroke_extrusion && g_nonscaling_stroke) {\n"
+			"    vec2 extrusion = (modelview_projection * vec4(a_extrusion, 0.0, 0.0)).xy;\n"
+			"    float extrusion_pixels = length(extrusion * viewport_half);\n"
+			"    if(extrusion_pixels > 0.0)\n"
+			"      gl_Position.xy += extrusion * (stroke_width * length(a_extrusion) / extrusion_pixels) * grow;\n"
+			"  }\n"
+			"  v_maskCoord = gl_Position.xy * 0.5 + 0.5;\n"
+			"  p_textureCoord = p_projection * vec4(gl_Position.xy, 0.0, 1.0);\n"
+			"  v_textureCoord = (u_textureMatrix * vec3(a_textureCoord, 1.0)).xy;\n"
+			"  gradient_coord = (surf2paint * gl_Position).xy;\n"
+			"  v_vertexColor = a_color;\n"
+			"  v_arcLength = a_arcLength;\n"
+			"  v_disc = a_disc * 2.0 * a_extrusion * grow;\n"
+			"  v_edge = vec2(a_side * (half_width_px + 1.0), half_width_px + 0.5);\n"
+			"  v_coverage = a_coverage;\n"
+			"}\n";
+
+		return vshad.str();
+	}
+
+	std::string Shader::build_generic_fragment_shader() {
+		std::stringstream fshad;
+
+		fshad <<
+			"precision highp float;\n";
+		add_generic_flags(fshad);
+		fshad <<
+			"uniform int g_mode;\n"   // primary mode
+			"uniform int g_spread;\n" // gradient spread mode >> 4
+
+			"uniform vec4 v_color;\n"
+			"uniform sampler2D m_texture;\n"
+			"uniform sampler2D p_texture;\n"
+			"uniform sampler2D u_textureSampler;\n"
+			"uniform vec4 ctransform_scale;\n"
+			"uniform vec4 ctransform_bias;\n"
+			"uniform float dash_ends[" << GNUVG_MAX_GPU_DASHES << "];\n"
+			"uniform int nr_dashes;\n"
+			"uniform float dash_period;\n"
+			"uniform float dash_phase;\n"
+			<< color_ramp_uniforms
+			<< two_stop_ramp_uniforms
+			<< linear_gradient_uniforms
+			<< radial_gradient_uniforms <<
+
+			"varying vec2 v_maskCoord;\n"
+			"varying vec4 p_textureCoord;\n"
+			"varying vec2 v_textureCoord;\n"
+			"varying vec2 gradient_coord;\n"
+			"varying vec4 v_vertexColor;\n"
+			"varying float v_arcLength;\n"
+			"varying vec2 v_disc;\n"
+			"varying vec2 v_edge;\n"
+			"varying float v_coverage;\n"
+
+			"\n"
+			"void main() {\n"
+			"  if(g_dash) {\n"
+			"    float d = mod(v_arcLength + dash_phase, dash_period);\n"
+			"    float dashes_passed = 0.0;\n"
+			"    for(int i = 0; i < " << GNUVG_MAX_GPU_DASHES << "; i++) {\n"
+			"      if(i >= nr_dashes) break;\n"
+			"      if(d >= dash_ends[i]) dashes_passed += 1.0;\n"
+			"    }\n"
+			"    if(mod(dashes_passed, 2.0) >= 1.0) discard;\n"
+			"  }\n"
+
+			"  float coverage = 1.0;\n"
+			"  if(g_coverage && g_stroke_extrusion) {\n"
+			"    coverage = clamp(v_edge.y - abs(v_edge.x), 0.0, 1.0);\n"
+			"    if(g_disc)\n"
+			"      coverage = min(coverage, clamp((1.0 - length(v_disc)) * (v_edge.y - 0.5) + 0.5, 0.0, 1.0));\n"
+			"  } else if(g_coverage) {\n"
+			"    coverage = v_coverage;\n"
+			"  } else if(g_disc && dot(v_disc, v_disc) > 1.0) {\n"
+			"    discard;\n"
+			"  }\n"
+
+			"  vec4 c = v_color;\n"
+			"  if(g_mode == " << do_linear_gradient << " || g_mode == " << do_radial_gradient << ") {\n"
+			"    float g;\n"
+			"    if(g_mode == " << do_linear_gradient << ") {\n"
+			<< linear_gradient_code <<
+			"    } else {\n"
+			<< radial_gradient_code <<
+			"    }\n"
+			"    if(g_spread == " << (do_gradient_pad >> 4) << ") {\n"
+			<< pad_spread_code <<
+			"    } else if(g_spread == " << (do_gradient_repeat >> 4) << ") {\n"
+			<< repeat_spread_code <<
+			"    } else {\n"
+			<< reflect_spread_code <<
+			"    }\n"
+			"    if(g_two_stop_ramp) {\n"
+			<< two_stop_ramp_code <<
+			"    } else {\n"
+			<< color_ramp_code <<
+			"    }\n"
+			"  } else if(g_mode == " << do_pattern << ") {\n"
+			"    c = texture2D(p_texture, p_textureCoord.xy);\n"
+			"  } else if(g_mode == " << do_texture << ") {\n"
+			"    c = texture2D(u_textureSampler, v_textureCoord.xy);\n"
+			"  } else if(g_mode == " << do_vertex_color << ") {\n"
+			"    c = v_vertexColor;\n"
+			"  }\n"
+
+			"  if(g_mask)\n"
+			"    c = texture2D(m_texture, v_maskCoord).r * c;\n"
+			"  if(g_texture_alpha)\n"
+			"    c = texture2D(u_textureSampler, v_textureCoord.xy).r * c;\n"
+			"  if(g_color_transform)\n"
+			"    c = c * ctransform_scale + ctransform_bias;\n"
+			"  gl_FragColor = c;\n"
+			"  gl_FragColor.a *= coverage;\n"
+			"}\n";
+
+		return fshad.str();
+	}
+};
@@ -0,0 +1,137 @@
+/*
+ * gnuVG - a free Vector Graphics library
+ * Copyright (C) 2016 by Anton Persson
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Names of the uniforms, attributes and generic shader flags,
+ * shared by the library and the gnuVG_shadergen tool.
+ */
+
+#include "gnuVG_shader.hh"
+
+namespace gnuVG {
+	// the features the generic shader selects with bool uniforms
+	const Shader::NamedCapability Shader::generic_flags[] = {
+		{ do_pretranslate, "g_pretranslate" },
+		{ do_mask, "g_mask" },
+		{ do_stroke_extrusion, "g_stroke_extrusion" },
+		{ do_nonscaling_stroke, "g_nonscaling_stroke" },
+		{ do_dash, "g_dash" },
+		{ do_disc, "g_disc" },
+		{ do_coverage, "g_coverage" },
+		{ do_color_transform, "g_color_transform" },
+		{ do_texture_alpha, "g_texture_alpha" },
+		{ do_two_stop_ramp, "g_two_stop_ramp" },
+	};
+	const size_t Shader::nr_generic_flags =
+		sizeof(generic_flags) / sizeof(generic_flags[0]);
+
+	// in the order of Shader::handle_members below
+	const Shader::HandleName Shader::handle_names[] = {
+		{ "v_position", true },
+		{ "a_color", true },
+		{ "a_extrusion", true },
+		{ "a_arcLength", true },
+		{ "a_disc", true },
+		{ "a_side", true },
+		{ "a_coverage", true },
+		{ "a_textureCoord", true },
+		{ "u_textureMatrix", false },
+		{ "u_textureSampler", false },
+		{ "v_color", false },
+		{ "modelview_projection", false },
+		{ "pre_translation", false },
+		{ "stroke_width", false },
+		{ "viewport_half", false },
+		{ "dash_ends", false },
+		{ "nr_dashes", false },
+		{ "dash_period", false },
+		{ "dash_phase", false },
+		{ "half_width_px", false },
+		{ "m_texture", false },
+		{ "gauss_kernel", false },
+		{ "gauss_pairs", false },
+		{ "gauss_step", false },
+		{ "p_texture", false },
+		{ "p_projection", false },
+		{ "surf2paint", false },
+		{ "ctransform_scale", false },
+		{ "ctransform_bias", false },
+		{ "linear_normal", false },
+		{ "linear_start", false },
+		{ "linear_length", false },
+		{ "radial", false },
+		{ "radius2", false },
+		{ "radial_denom", false },
+		{ "ramp_texture", false },
+		{ "ramp_row", false },
+		{ "ramp_start", false },
+		{ "ramp_end", false },
+		{ "ramp_span", false },
+	};
+	const size_t Shader::nr_handles =
+		sizeof(handle_names) / sizeof(handle_names[0]);
+
+	GLint Shader::* const Shader::handle_members[] = {
+		&Shader::position_handle,
+		&Shader::color_handle,
+		&Shader::extrusion_handle,
+		&Shader::arc_length_handle,
+		&Shader::disc_handle,
+		&Shader::side_handle,
+		&Shader::coverage_handle,
+		&Shader::textureCoord_handle,
+		&Shader::textureMatrix_handle,
+		&Shader::textureSampler_handle,
+		&Shader::ColorHandle,
+		&Shader::Matrix,
+		&Shader::preTranslation,
+		&Shader::strokeWidth,
+		&Shader::viewportHalf,
+		&Shader::dashEnds,
+		&Shader::nrDashes,
+		&Shader::dashPeriod,
+		&Shader::dashPhase,
+		&Shader::halfWidthPixels,
+		&Shader::maskTexture,
+		&Shader::gaussKernel,
+		&Shader::gaussPairs,
+		&Shader::gaussStep,
+		&Shader::patternTexture,
+		&Shader::patternMatrix,
+		&Shader::surf2paint,
+		&Shader::ctransform_scale,
+		&Shader::ctransform_bias,
+		&Shader::linear_normal,
+		&Shader::linear_start,
+		&Shader::linear_length,
+		&Shader::radial,
+		&Shader::radius2,
+		&Shader::radial_denom,
+		&Shader::rampTexture,
+		&Shader::rampRow,
+		&Shader::rampStart,
+		&Shader::rampEnd,
+		&Shader::rampSpan,
+	};
+
+	static_assert(sizeof(Shader::handle_members) / sizeof(Shader::handle_members[0]) ==
+		      sizeof(Shader::handle_names) / sizeof(Shader::handle_names[0]),
+		      "handle_members and handle_names must match");
+	static_assert(sizeof(Shader::handle_names) / sizeof(Shader::handle_names[0]) <= 64,
+		      "the handle mask holds 64 handles");
+};
@@ -0,0 +1,41 @@
+/*
+ * gnuVG - a free Vector Graphics library
+ * Copyright (C) 2016 by Anton Persson
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace gnuVG {
+
+	/* GLSL for the capability sets in Shader::table_capabilities(),
+	 * generated at build time into gnuVG_shadertable.cc.
+	 */
+	struct ShaderTableEntry {
+		int caps;
+		const char *vertex_shader;
+		const char *fragment_shader;
+		uint64_t handles; // see Shader::used_handles()
+	};
+
+	// sorted by caps
+	extern const ShaderTableEntry shader_table[];
+	extern const size_t shader_table_size;
+
+};
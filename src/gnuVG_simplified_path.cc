@@ -19,15 +19,27 @@
 
 #include "gnuVG_simplified_path.hh"
 #include "gnuVG_context.hh"
+#include "gnuVG_config.hh"
 
 //#define __DO_GNUVG_DEBUG
 #include "gnuVG_debug.hh"
 
+#define ENABLE_GNUVG_PROFILER
+#include <VG/gnuVG_profiler.hh>
+
 // Max recursion depth for cubic subdivision
 #define MAX_RENDER_SUBDIVISION 16
+// ...when the rendering quality is not VG_RENDERING_QUALITY_BETTER
+#define FAST_RENDER_SUBDIVISION 8
 
 // Define pixel size factor for subdivision limit
 #define PIXEL_SIZE_FACTOR 0.125f
+// ...when the rendering quality is not VG_RENDERING_QUALITY_BETTER
+#define FAST_PIXEL_SIZE_FACTOR 1.0f
+
+// Joins with a miter factor below this share vertices even when
+// they should be beveled, the difference is not visible
+#define WELD_MITER_FACTOR 1.02f
 
 namespace gnuVG {
 	/*********************************************************
@@ -39,20 +51,35 @@ namespace gnuVG {
 		no_join, join_miter, join_round, join_bevel
 	};
 
-	static Point pen, last_direction, first_direction;
-	static JoinStyle join_style, default_join_style;
+	enum CapStyle {
+		cap_butt, cap_round, cap_square
+	};
+
+	static Point pen, last_direction, first_direction; // directions are unit length
+	static VGfloat pen_arc_length; // distance along the path, used for dashing
+	static JoinStyle default_join_style;
+	static CapStyle cap_style;
 
 	static Point contour_start;
+	static VGfloat contour_start_arc_length;
 	static bool start_new_contour;
+	static bool contour_was_split; // the contour did not fit in one batch
+	static bool pen_at_contour_start; // nothing stroked yet in this contour
 
 	static unsigned int nr_vertices;
-	static GvgVector<VGfloat> v_array; // vertices
-	static GvgVector<unsigned int> t_array; // triangle vertice indices
-	static unsigned int previous_segment[4]; // indices for previous segment
-	static unsigned int current_segment[4]; // indices for current segment
-	static unsigned int first_segment[4]; // indices for current segment
+	static GvgVector<VGfloat> v_array; // vertices - centerline x, y, extrusion x, y and arc length
+	static GvgVector<unsigned short> t_array; // triangle vertice indices
+	static std::vector<SimplifiedPath::StrokeMesh> *stroke_output;
+
+	/* Consecutive segments share the vertice pair between them,
+	 * we only keep the pair where the open segment starts and the
+	 * pair where the contour started.
+	 */
+	static bool segment_is_open; // an outline starts at segment_start
+	static unsigned int segment_start[2]; // left/right indices where the open segment starts
+	static bool first_pair_is_valid; // the first segment started at contour_start
+	static unsigned int first_pair[2]; // left/right indices of the first segment
 
-	static VGfloat stroke_width = 1.0f;
 	static VGfloat miter_limit = 1.0f;
 
 	static std::vector<VGfloat> dash_pattern;
@@ -358,6 +385,8 @@ namespace gnuVG {
 					   const VGfloat* pathData,
 					   VGint numSegments) {
 		GNUVG_DEBUG("SimplifiedPath::simplify_path()\n");
+		stroke_cache_is_valid = false;
+		hairline_cache_is_valid = false;
 		VGint remaining_segments = numSegments;
 		const VGubyte *sgmt = pathSegments;
 		const VGfloat *dat = pathData;
@@ -631,14 +660,19 @@ namespace gnuVG {
 			finish_contour(false);
 	}
 
+	static inline bool fast_rendering() {
+		return Context::get_current()->get_rendering_quality() != VG_RENDERING_QUALITY_BETTER;
+	}
+
 	static Point calculate_pixelsize() {
 		Point pixel_size;
 		auto x_mapped = Context::get_current()->map_point(Point(1.0f, 0.0f));
 		auto y_mapped = Context::get_current()->map_point(Point(0.0f, 1.0f));
 		auto origo_mapped = Context::get_current()->map_point(Point(0.0f, 0.0f));
 
-		pixel_size.x = PIXEL_SIZE_FACTOR / (x_mapped - origo_mapped).length();
-		pixel_size.y = PIXEL_SIZE_FACTOR / (y_mapped - origo_mapped).length();
+		auto factor = fast_rendering() ? FAST_PIXEL_SIZE_FACTOR : PIXEL_SIZE_FACTOR;
+		pixel_size.x = factor / (x_mapped - origo_mapped).length();
+		pixel_size.y = factor / (y_mapped - origo_mapped).length();
 
 		return pixel_size;
 	}
@@ -665,7 +699,8 @@ namespace gnuVG {
 		cubics[0].points[3] = e;
 
 		// we need -1 for comparison
-		constexpr auto recursion_depth = MAX_RENDER_SUBDIVISION - 1;
+		auto recursion_depth =
+			(fast_rendering() ? FAST_RENDER_SUBDIVISION : MAX_RENDER_SUBDIVISION) - 1;
 
 		while (cindex >= 0) {
 			c = &cubics[cindex];
@@ -761,9 +796,15 @@ namespace gnuVG {
 			);
 	}
 
-	static void push_vertice(const Point &p) {
+	static void push_vertice(const Point &p, const Point &extrusion, VGfloat arc_length,
+				 VGfloat side = 0.0f, VGfloat disc = 0.0f) {
 		v_array.push_back(p.x);
 		v_array.push_back(p.y);
+		v_array.push_back(extrusion.x);
+		v_array.push_back(extrusion.y);
+		v_array.push_back(arc_length);
+		v_array.push_back(disc);
+		v_array.push_back(side);
 		++nr_vertices;
 	}
 
@@ -772,137 +813,229 @@ namespace gnuVG {
 			t_array.push_back(vertice_index[k]);
 	}
 
-	static void add_miter_join(VGfloat angle, const Point &last_normal, const Point &new_normal) {
-		// convert the angle between the direction into the angle
-		// between the old line segment and the new
-		VGfloat line_angle = angle < 0.0 ? M_PI + angle : M_PI - angle; // make sure it's a positive
-
-		// calculate the miter size
-		VGfloat miter_factor = 1.0f / sin(line_angle / 2.0f);
-		if(miter_factor > miter_limit) return; // beyond the limit, don't do miter join
-		VGfloat miter_size = miter_factor * stroke_width;
-
-		// calculate the additional triangle that the miter adds
-		miter_size /= 2.0f;
-		line_angle /= 2.0f;
-		miter_size *= cos(line_angle);
-
-		// check which side the miter should be on
-		unsigned int old_point_index;
-		if(angle < 0.0f) {
-			unsigned int triangle[] = {
-				previous_segment[1], nr_vertices, current_segment[0]
-			};
-			push_triangle(triangle);
-			old_point_index = triangle[0] << 1;
-		} else {
-			unsigned int triangle[] = {
-				previous_segment[3], current_segment[2], nr_vertices
-			};
-			push_triangle(triangle);
-			old_point_index = triangle[0] << 1;
-		}
-		Point old_point(v_array[old_point_index], v_array[old_point_index + 1]);
-		miter_size /= last_direction.length();
-		Point triangle_tip = old_point + miter_size * last_direction;
-		push_vertice(triangle_tip);
+	static void get_vertice(unsigned int index, Point &p, Point &extrusion, VGfloat &arc_length) {
+		auto v = &v_array[index * GNUVG_STROKE_VERTEX_SIZE];
+		p = Point(v[0], v[1]);
+		extrusion = Point(v[2], v[3]);
+		arc_length = v[4];
 	}
 
-	static void add_bevel_join(VGfloat angle, const Point &last_normal, const Point &new_normal) {
-		if(angle < 0.0f) { // bevel on left side of direction
-			unsigned int triangle[] = {
-				previous_segment[1], current_segment[0], previous_segment[3]
-			};
-			push_triangle(triangle);
-		} else { // bevel on right side
-			unsigned int triangle[] = {
-				previous_segment[3], current_segment[0], current_segment[2]
-			};
-			push_triangle(triangle);
+	static void set_extrusion(unsigned int index, const Point &extrusion) {
+		auto v = &v_array[index * GNUVG_STROKE_VERTEX_SIZE];
+		v[2] = extrusion.x;
+		v[3] = extrusion.y;
+	}
+
+	static void flush_stroke_data() {
+		if(t_array.size() > 0) {
+			stroke_output->emplace_back();
+			auto &mesh = stroke_output->back();
+			mesh.vertices.assign(v_array.begin(), v_array.end());
+			mesh.indices.assign(t_array.begin(), t_array.end());
 		}
+
+		v_array.clear();
+		t_array.clear();
+		nr_vertices = 0;
 	}
 
-	static void add_join(const Point &new_direction) {
-		if(join_style == no_join) {
-			// add no join, but remember this specific direction
-			first_direction = new_direction;
-			for(unsigned int k = 0; k < 4; k++) {
-				first_segment[k] = current_segment[k];
-			}
-		} else {
-			auto width_factor = (stroke_width / last_direction.length()) * 0.5f;
-			Point last_normal = width_factor * last_direction.normal();
-			Point new_normal = width_factor * new_direction.normal();
-
-			auto cross = last_direction.cross(new_direction);
-			auto dot = last_direction.dot(new_direction);
-			auto angle = atan2(cross, dot);
-
-			// we only need to create a join if the we have a non-zero angle
-			if(angle != 0.0f) {
-				switch(join_style) {
-				default:
-				case no_join: /* this case is already handled above */
-					break;
+	// make sure count more vertices fit in the 16-bit indices,
+	// if not we flush and carry the open segment over
+	static void make_room_for(unsigned int count) {
+		if(nr_vertices + count <= GNUVG_MAX_INDEXED_VERTICES)
+			return;
 
-				case join_round:
-					// xxx not properly implemented yet
-					add_bevel_join(angle, last_normal, new_normal);
-					break;
-				case join_miter:
-					add_bevel_join(angle, last_normal, new_normal);
-					add_miter_join(angle, last_normal, new_normal);
-					break;
-				case join_bevel:
-					add_bevel_join(angle, last_normal, new_normal);
-					break;
-				}
-			}
+		Point p, left, right;
+		VGfloat arc_length = 0.0f;
+		if(segment_is_open) {
+			get_vertice(segment_start[0], p, left, arc_length);
+			get_vertice(segment_start[1], p, right, arc_length);
 		}
-		join_style = join_bevel; // set join_style to bevel until a new segment is completed
-		last_direction = new_direction;
-	}
 
-	static void close_to_first_segment() {
-		for(unsigned int k = 0; k < 4; k++) {
-			previous_segment[k] = current_segment[k];
-			current_segment[k] = first_segment[k];
+		flush_stroke_data();
+		contour_was_split = true;
+
+		if(segment_is_open) {
+			segment_start[0] = nr_vertices;
+			push_vertice(p, left, arc_length, 1.0f);
+			segment_start[1] = nr_vertices;
+			push_vertice(p, right, arc_length, -1.0f);
 		}
 	}
 
-	static void push_segment_outline_triangles(const Point &normal, const Point &stroke) {
-		for(unsigned int k = 0; k < 4; k++) {
-			previous_segment[k] = current_segment[k];
-			current_segment[k] = nr_vertices + k;
-		}
+	// push the left and right vertices of the outline at the pen
+	static void push_vertice_pair(const Point &extrusion, unsigned int pair[2]) {
+		pair[0] = nr_vertices;
+		push_vertice(pen, extrusion, pen_arc_length, 1.0f);
+		pair[1] = nr_vertices;
+		push_vertice(pen, -1.0f * extrusion, pen_arc_length, -1.0f);
+	}
 
-		unsigned int triangle_a[] = {nr_vertices + 0, nr_vertices + 1, nr_vertices + 2};
-		unsigned int triangle_b[] = {nr_vertices + 1, nr_vertices + 3, nr_vertices + 2};
+	// fill the outline between two vertice pairs
+	static void push_segment_triangles(const unsigned int start[2],
+					   const unsigned int end[2]) {
+		unsigned int triangle_a[] = {start[0], end[0], start[1]};
+		unsigned int triangle_b[] = {end[0], end[1], start[1]};
 
-		push_vertice(pen + normal);
-		push_vertice(pen + normal + stroke);
-		push_vertice(pen - normal);
-		push_vertice(pen - normal + stroke);
+		push_triangle(triangle_a);
+		push_triangle(triangle_b);
+	}
+
+	// extrusion for a unit stroke width, the shader scales it
+	static inline Point stroke_normal(const Point &direction) {
+		return 0.5f * Point(-direction.y, direction.x);
+	}
 
+	/* A quad around p, the shader discards everything outside
+	 * the disc with the stroke width as its diameter.
+	 * The caller must make room for four vertices.
+	 */
+	static void push_disc(const Point &p, VGfloat arc_length) {
+		unsigned int base = nr_vertices;
+		push_vertice(p, Point(-0.5f, -0.5f), arc_length, 0.0f, 1.0f);
+		push_vertice(p, Point( 0.5f, -0.5f), arc_length, 0.0f, 1.0f);
+		push_vertice(p, Point(-0.5f,  0.5f), arc_length, 0.0f, 1.0f);
+		push_vertice(p, Point( 0.5f,  0.5f), arc_length, 0.0f, 1.0f);
+
+		unsigned int triangle_a[] = {base, base + 1, base + 2};
+		unsigned int triangle_b[] = {base + 1, base + 3, base + 2};
 		push_triangle(triangle_a);
 		push_triangle(triangle_b);
 	}
 
+	// cap at p, on an outline that leaves p going in direction
+	static void add_cap(const Point &p, VGfloat arc_length, const Point &direction) {
+		if(cap_style == cap_butt) return;
+
+		make_room_for(4);
+
+		if(cap_style == cap_round) {
+			push_disc(p, arc_length);
+			return;
+		}
+
+		auto normal = stroke_normal(direction);
+		auto extension = 0.5f * direction;
+		unsigned int base[2], tip[2];
+		base[0] = nr_vertices;
+		push_vertice(p, normal, arc_length, 1.0f);
+		base[1] = nr_vertices;
+		push_vertice(p, -1.0f * normal, arc_length, -1.0f);
+		tip[0] = nr_vertices;
+		push_vertice(p, normal + extension, arc_length, 1.0f);
+		tip[1] = nr_vertices;
+		push_vertice(p, extension - normal, arc_length, -1.0f);
+		push_segment_triangles(base, tip);
+	}
+
+	/* Finish the open segment at the pen and start the next one
+	 * going in new_direction. When the join is a miter, or the
+	 * angle is small enough that a bevel would not be visible,
+	 * both segments share the same vertices at the pen.
+	 */
+	static void add_join(const Point &new_direction) {
+		make_room_for(8);
+
+		auto last_normal = stroke_normal(last_direction);
+		auto new_normal = stroke_normal(new_direction);
+
+		auto cross = last_direction.cross(new_direction);
+		auto dot = last_direction.dot(new_direction);
+
+		// miter length relative to the stroke width, 1 / sin(angle / 2)
+		auto miter_factor = dot > -1.0f ? sqrtf(2.0f / (1.0f + dot)) : miter_limit + 1.0f;
+		bool do_weld =
+			miter_factor <= WELD_MITER_FACTOR ||
+			(default_join_style == join_miter && miter_factor <= miter_limit);
+
+		unsigned int start[2];
+		if(do_weld) {
+			auto miter = (1.0f / (1.0f + dot)) * (last_normal + new_normal);
+			push_vertice_pair(miter, start);
+			push_segment_triangles(segment_start, start);
+		} else {
+			unsigned int end[2];
+			push_vertice_pair(last_normal, end);
+			push_segment_triangles(segment_start, end);
+			push_vertice_pair(new_normal, start);
+
+			if(default_join_style == join_round) {
+				push_disc(pen, pen_arc_length);
+			} else if(cross < 0.0f) { // bevel on left side of direction
+				unsigned int triangle[] = {end[0], start[0], end[1]};
+				push_triangle(triangle);
+			} else { // bevel on right side
+				unsigned int triangle[] = {end[1], start[1], end[0]};
+				push_triangle(triangle);
+			}
+		}
+
+		segment_start[0] = start[0];
+		segment_start[1] = start[1];
+	}
+
+	// finish the open segment at the pen without a join
+	static void end_segment(bool add_end_cap = true) {
+		if(!segment_is_open) return;
+
+		make_room_for(2);
+
+		unsigned int end[2];
+		push_vertice_pair(stroke_normal(last_direction), end);
+		push_segment_triangles(segment_start, end);
+		segment_is_open = false;
+
+		if(add_end_cap)
+			add_cap(pen, pen_arc_length, last_direction);
+	}
+
+	// the cap where the contour begins, if it was stroked
+	static void add_contour_start_cap() {
+		if(first_pair_is_valid)
+			add_cap(contour_start, contour_start_arc_length,
+				-1.0f * first_direction);
+	}
+
+	// stroke a line from the pen to p, direction is unit length
+	static void stroke_line_to(const Point &p, const Point &direction) {
+		if(segment_is_open) {
+			add_join(direction);
+		} else {
+			// a dash starts here, the contour start is capped
+			// when we know if the contour is closed
+			if(!pen_at_contour_start)
+				add_cap(pen, pen_arc_length, -1.0f * direction);
+
+			make_room_for(2);
+			push_vertice_pair(stroke_normal(direction), segment_start);
+			segment_is_open = true;
+
+			if(pen_at_contour_start) {
+				first_pair_is_valid = true;
+				first_pair[0] = segment_start[0];
+				first_pair[1] = segment_start[1];
+				first_direction = direction;
+			}
+		}
+		pen_at_contour_start = false;
+		last_direction = direction;
+		pen_arc_length += (p - pen).length();
+		pen = p;
+	}
+
 	static void create_segment_outline(const Point &p) {
 		Point direction = p - pen;
-		if(direction.length() == 0) return;
+		VGfloat length = direction.length();
+		if(length == 0) return;
 
-		Point normal = (stroke_width / direction.length()) * 0.5 * Point(-direction.y, direction.x);
+		direction = (1 / length) * direction; // make unit vector
 
 		if(dash_pattern.size() == 0) {
 			// non-dashed
-			push_segment_outline_triangles(normal, direction);
-			add_join(direction);
-			pen = pen + direction;
+			stroke_line_to(p, direction);
 		} else {
 			// dashed
-			VGfloat remaining = direction.length();
-			direction = (1 / direction.length()) * direction; // make unit vector
+			VGfloat remaining = length;
 
 			while(remaining > 0.0f) {
 				VGfloat step_length = remaining < dash_segment_phase_left ? remaining : dash_segment_phase_left;
@@ -913,32 +1046,190 @@ namespace gnuVG {
 
 				if(dash_segment_index % 2) {
 					// dash is OFF
-					join_style = no_join;
+					end_segment();
+					pen_at_contour_start = false;
+					last_direction = direction;
+					pen_arc_length += step_length;
+					pen = pen + stroke;
 				} else {
-					push_segment_outline_triangles(normal, stroke);
-					add_join(direction);
+					stroke_line_to(pen + stroke, direction);
 				}
 				while(dash_segment_phase_left <= 0.0f) {
 					dash_segment_index = (dash_segment_index + 1) % dash_pattern.size();
 					dash_segment_phase_left += dash_pattern[dash_segment_index];
 				}
-				pen = pen + stroke;
 			}
 		}
 	}
 
-	void SimplifiedPath::get_stroke_shape(
+	static void close_contour() {
+		create_segment_outline(contour_start);
+		make_room_for(8);
+
+		/* Join the end with the start, if both are still around.
+		 * The end has another arc length than the start, so it
+		 * gets its own vertices, but the start is moved to match.
+		 */
+		if(segment_is_open && first_pair_is_valid && !contour_was_split) {
+			add_join(first_direction);
+			for(int k = 0; k < 2; k++) {
+				Point p, extrusion;
+				VGfloat arc_length;
+				get_vertice(segment_start[k], p, extrusion, arc_length);
+				set_extrusion(first_pair[k], extrusion);
+			}
+			segment_is_open = false;
+		} else {
+			// when a split contour meets itself, caps would stick out
+			bool ends_meet = contour_was_split && segment_is_open && first_pair_is_valid;
+			end_segment(!ends_meet);
+			if(!ends_meet)
+				add_contour_start_cap();
+		}
+	}
+
+	// line from the pen to p, without any joins
+	static void hairline_to(const Point &p) {
+		// hairlines are not extruded
+		if(nr_vertices + 1 > GNUVG_MAX_INDEXED_VERTICES) {
+			flush_stroke_data();
+			push_vertice(pen, Point(), pen_arc_length);
+		}
+
+		pen_arc_length += (p - pen).length();
+		pen = p;
+		push_vertice(pen, Point(), pen_arc_length);
+
+		t_array.push_back(nr_vertices - 2);
+		t_array.push_back(nr_vertices - 1);
+	}
+
+	static void replay_stroke_cache(
+		const std::vector<SimplifiedPath::StrokeMesh> &cache,
+		std::function<void(const SimplifiedPath::StrokeData &)> render_callback) {
+		for(auto &mesh : cache) {
+			SimplifiedPath::StrokeData sdat = {
+				.vertices = mesh.vertices.data(),
+				.indices = mesh.indices.data(),
+				.nr_vertices = mesh.vertices.size() / GNUVG_STROKE_VERTEX_SIZE,
+				.nr_indices = mesh.indices.size()
+			};
+			render_callback(sdat);
+		}
+	}
+
+	void SimplifiedPath::get_hairline_shape(
 		std::function<void(const StrokeData &)> render_callback) {
+		StrokeKey key;
+		key.pixel_size = calculate_pixelsize();
+		key.join_style = VG_JOIN_BEVEL;
+		key.cap_style = VG_CAP_BUTT;
+		key.miter_limit = 0.0f;
+		key.dash_phase = 0.0f;
+
+		if(!(hairline_cache_is_valid && hairline_cache_key.can_replace(key))) {
+			hairline_cache_key = key;
+			create_hairline(key);
+			hairline_cache_is_valid = true;
+		}
+
+		replay_stroke_cache(hairline_cache, render_callback);
+	}
+
+	void SimplifiedPath::create_hairline(const StrokeKey &key) {
+		ADD_GNUVG_PROFILER_PROBE(create_hairline);
+
 		start_new_contour = true;
+		segment_is_open = false;
+		pen_arc_length = 0.0f;
+		hairline_cache.clear();
+		stroke_output = &hairline_cache;
+
+		v_array.clear();
+		t_array.clear();
+		nr_vertices = 0;
+
+		auto add_vertice = [this](const Point &p) {
+			if(start_new_contour) {
+				start_new_contour = false;
+				contour_start = pen = p;
+				make_room_for(1);
+				push_vertice(pen, Point(), pen_arc_length);
+			} else
+				hairline_to(p);
+		};
+
+		auto finalize_contour =
+			[this](bool do_close) {
+			start_new_contour = true;
+
+			if(do_close)
+				hairline_to(contour_start);
+		};
+
+		auto pixsize = key.pixel_size;
+		auto process_curve =
+			[pixsize, add_vertice](
+				const Point& s,
+				const Point& c1,
+				const Point& c2,
+				const Point& e) {
+			flatten_curve(pixsize, s, c1, c2, e, add_vertice);
+		};
 
-		// store the stroke widht internally
-		stroke_width = Context::get_current()->get_stroke_width();
+		process_path(
+			add_vertice,
+			finalize_contour,
+			process_curve
+			);
+
+		flush_stroke_data();
+	}
+
+	void SimplifiedPath::get_stroke_shape(
+		std::function<void(const StrokeData &)> render_callback) {
+		auto ctx = Context::get_current();
+
+		/* The stroke geometry does not depend on the stroke width,
+		 * so we can keep using the cached stroke as long as the
+		 * rest of the parameters are the same, and the flattening
+		 * is still fine enough. Short dash patterns are applied
+		 * by the shader, so they don't affect the geometry either.
+		 */
+		StrokeKey key;
+		key.pixel_size = calculate_pixelsize();
+		key.join_style = ctx->get_join_style();
+		key.cap_style = ctx->get_cap_style();
+		key.miter_limit = ctx->get_miter_limit();
+		if(ctx->dash_on_gpu()) {
+			key.dash_phase = 0.0f;
+		} else {
+			key.dash_pattern = ctx->get_dash_pattern();
+			key.dash_phase = ctx->get_dash_phase();
+		}
+
+		if(!(stroke_cache_is_valid && stroke_cache_key.can_replace(key))) {
+			stroke_cache_key = key;
+			create_stroke(key);
+			stroke_cache_is_valid = true;
+		}
+
+		replay_stroke_cache(stroke_cache, render_callback);
+	}
+
+	void SimplifiedPath::create_stroke(const StrokeKey &key) {
+		ADD_GNUVG_PROFILER_PROBE(create_stroke);
+
+		start_new_contour = true;
+		pen_arc_length = 0.0f;
+		stroke_cache.clear();
+		stroke_output = &stroke_cache;
 
 		// store the miter limit internally
-		miter_limit = Context::get_current()->get_miter_limit();
+		miter_limit = key.miter_limit;
 
 		// get default join style
-		switch(Context::get_current()->get_join_style()) {
+		switch(key.join_style) {
 		case VG_JOIN_STYLE_FORCE_SIZE:
 			break;
 		case VG_JOIN_MITER:
@@ -952,13 +1243,26 @@ namespace gnuVG {
 			break;
 		}
 
+		switch(key.cap_style) {
+		case VG_CAP_STYLE_FORCE_SIZE:
+		case VG_CAP_BUTT:
+			cap_style = cap_butt;
+			break;
+		case VG_CAP_ROUND:
+			cap_style = cap_round;
+			break;
+		case VG_CAP_SQUARE:
+			cap_style = cap_square;
+			break;
+		}
+
 		// get dash pattern
-		dash_pattern = Context::get_current()->get_dash_pattern();
+		dash_pattern = key.dash_pattern;
 		dash_segment_index = 0;
 
 		// prepare dash
 		if(dash_pattern.size() > 0) {
-			VGfloat dash_phase = Context::get_current()->get_dash_phase();
+			VGfloat dash_phase = key.dash_phase;
 			dash_segment_index = 0;
 			while(dash_phase > dash_pattern[dash_segment_index]) {
 				dash_phase -= dash_pattern[dash_segment_index];
@@ -969,49 +1273,37 @@ namespace gnuVG {
 			dash_segment_phase_left = dash_pattern[dash_segment_index] - dash_phase;
 		}
 
-		// first segment should not create a joint
-		join_style = no_join;
+		// all contours are collected and rendered together
 		v_array.clear();
 		t_array.clear();
+		nr_vertices = 0;
 
 		auto add_vertice = [this](const Point &p) {
 			if(start_new_contour) {
 				start_new_contour = false;
 				contour_start = pen = p;
-				v_array.clear();
-				t_array.clear();
-				nr_vertices = 0;
-			} else {
+				contour_start_arc_length = pen_arc_length;
+				contour_was_split = false;
+				pen_at_contour_start = true;
+				segment_is_open = false;
+				first_pair_is_valid = false;
+			} else
 				create_segment_outline(p);
-				join_style = default_join_style;
-			}
 		};
 
 		auto finalize_contour =
-			[this, render_callback](bool do_close) {
+			[this](bool do_close) {
 			start_new_contour = true;
 
-			if(do_close) {
-				create_segment_outline(contour_start);
-				join_style = default_join_style;
-				close_to_first_segment();
-				add_join(first_direction);
+			if(do_close)
+				close_contour();
+			else {
+				end_segment();
+				add_contour_start_cap();
 			}
-
-			join_style = no_join;
-
-			StrokeData sdat = {
-				.vertices = v_array.data(),
-				.indices = t_array.data(),
-				.nr_vertices = nr_vertices,
-				.nr_indices = t_array.size()
-				};
-
-			if(sdat.nr_indices > 0)
-				render_callback(sdat);
 		};
 
-		auto pixsize = calculate_pixelsize();
+		auto pixsize = key.pixel_size;
 		auto process_curve =
 			[pixsize, add_vertice](
 				const Point& s,
@@ -1026,5 +1318,7 @@ namespace gnuVG {
 			finalize_contour,
 			process_curve
 			);
+
+		flush_stroke_data();
 	}
 };
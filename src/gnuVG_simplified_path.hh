@@ -20,6 +20,7 @@
 #pragma once
 
 #include <functional>
+#include <vector>
 #include <libtess2.h>
 
 #include "gnuVG_math.hh"
@@ -41,12 +42,23 @@ namespace gnuVG {
 			Point c1, c2, ep; // coordinate data - depending on type
 		};
 
+		/* Stroke vertices are GNUVG_STROKE_VERTEX_SIZE floats each,
+		 * the centerline x, y followed by the extrusion x, y for
+		 * a stroke width of one, the arc length along the path,
+		 * a flag that is 1.0 for the corners of round join/cap quads
+		 * and the side of the outline, 1.0 or -1.0, for antialiasing.
+		 */
 		struct StrokeData {
 			const VGfloat *vertices;
-			const unsigned int *indices;
+			const unsigned short *indices;
 			uintptr_t nr_vertices, nr_indices;
 		};
 
+		struct StrokeMesh {
+			std::vector<VGfloat> vertices;
+			std::vector<unsigned short> indices;
+		};
+
 		GvgVector<Segment> segments;
 
 		void simplify_path(const VGubyte* pathSegments,
@@ -61,12 +73,55 @@ namespace gnuVG {
 		void tesselate_fill_shape(TESStesselator* tess);
 		void tesselate_fill_loop_n_blinn(VGFillRule rule, TESStesselator* tess);
 		void get_stroke_shape(std::function<void(const StrokeData &)> render_callback);
+		// same format as the stroke shape, with line indices
+		// and no extrusion, for strokes thinner than a pixel
+		void get_hairline_shape(std::function<void(const StrokeData &)> render_callback);
 
 	private:
 		// Bounding box data - top left, bottom right
 		// we can use these to calculate an on-screen bounding box easier.
 		Point bounding_box[2];
 
+		// Parameters that the stroke geometry depends on
+		struct StrokeKey {
+			Point pixel_size; // flattening tolerance
+			VGJoinStyle join_style;
+			VGCapStyle cap_style;
+			VGfloat miter_limit;
+			std::vector<VGfloat> dash_pattern;
+			VGfloat dash_phase;
+
+			// a stroke flattened for up to twice the precision
+			// we need can still be used
+			bool can_replace(const StrokeKey &other) const {
+				return
+					pixel_size.x <= other.pixel_size.x &&
+					pixel_size.y <= other.pixel_size.y &&
+					2.0f * pixel_size.x >= other.pixel_size.x &&
+					2.0f * pixel_size.y >= other.pixel_size.y &&
+					join_style == other.join_style &&
+					cap_style == other.cap_style &&
+					miter_limit == other.miter_limit &&
+					dash_pattern == other.dash_pattern &&
+					dash_phase == other.dash_phase;
+			}
+		};
+
+		// The last stroke we generated
+		bool stroke_cache_is_valid = false;
+		StrokeKey stroke_cache_key;
+		std::vector<StrokeMesh> stroke_cache;
+
+		void create_stroke(const StrokeKey &key);
+
+		// The last hairline we generated, only the
+		// flattening tolerance in the key matters
+		bool hairline_cache_is_valid = false;
+		StrokeKey hairline_cache_key;
+		std::vector<StrokeMesh> hairline_cache;
+
+		void create_hairline(const StrokeKey &key);
+
 		inline void add_cubic(Point &c1, Point &c2, Point &end_point) {
 			Segment ns;
 			ns.t = sp_cubic_to;
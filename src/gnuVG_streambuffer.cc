@@ -0,0 +1,126 @@
+/*
+ * gnuVG - a free Vector Graphics library
+ * Copyright (C) 2016 by Anton Persson
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <string.h>
+#include <EGL/egl.h>
+
+#include "gnuVG_streambuffer.hh"
+#include "gnuVG_glstate.hh"
+
+//#define __DO_GNUVG_DEBUG
+#include "gnuVG_debug.hh"
+
+#define ENABLE_GNUVG_PROFILER
+#include <VG/gnuVG_profiler.hh>
+
+namespace gnuVG {
+
+	// extension entry points are not always exported, look them up
+	static PFNGLMAPBUFFERRANGEEXTPROC map_buffer_range = nullptr;
+	static PFNGLUNMAPBUFFEROESPROC unmap_buffer = nullptr;
+	static int map_supported = -1;
+
+	static bool can_map() {
+		if(map_supported < 0) {
+			auto extensions = (const char *)glGetString(GL_EXTENSIONS);
+			if(extensions && strstr(extensions, "GL_EXT_map_buffer_range")) {
+				map_buffer_range = (PFNGLMAPBUFFERRANGEEXTPROC)
+					eglGetProcAddress("glMapBufferRangeEXT");
+				unmap_buffer = (PFNGLUNMAPBUFFEROESPROC)
+					eglGetProcAddress("glUnmapBufferOES");
+			}
+			map_supported = (map_buffer_range && unmap_buffer) ? 1 : 0;
+		}
+		return map_supported == 1;
+	}
+
+	StreamBuffer::StreamBuffer(GLenum _target, GLsizeiptr initial_size)
+		: target(_target)
+		, capacity(initial_size)
+	{}
+
+	StreamBuffer::~StreamBuffer() {
+		if(buffer) {
+			if(auto state = GLState::get_current())
+				state->forget_buffer(buffer);
+			glDeleteBuffers(1, &buffer);
+		}
+	}
+
+	void StreamBuffer::orphan(GLsizeiptr required_size) {
+		ADD_GNUVG_PROFILER_PROBE(stream_buffer_orphan);
+
+		while(capacity < required_size)
+			capacity *= 2;
+
+		// passing NULL lets the driver detach the old storage
+		// while draws referencing it are still in flight
+		glBufferData(target, capacity, NULL, GL_STREAM_DRAW);
+		checkGlError("StreamBuffer::orphan() - glBufferData");
+		head = 0;
+	}
+
+	void StreamBuffer::bind() {
+		auto state = GLState::get_current();
+		if(!buffer) {
+			glGenBuffers(1, &buffer);
+			state->bind_buffer(target, buffer);
+			orphan(capacity);
+			return;
+		}
+		state->bind_buffer(target, buffer);
+	}
+
+	void StreamBuffer::reserve(GLsizeiptr size) {
+		bind();
+
+		// the appends align their blocks to 4 bytes
+		if(((head + 3) & ~((GLsizeiptr)3)) + size > capacity)
+			orphan(size);
+	}
+
+	GLintptr StreamBuffer::append(const void *data, GLsizeiptr size) {
+		bind();
+
+		// keep every block 4-byte aligned
+		auto offset = (head + 3) & ~((GLsizeiptr)3);
+		if(offset + size > capacity) {
+			orphan(size);
+			offset = 0;
+		}
+
+		// nothing in flight reads this region before the next orphan
+		void *destination = nullptr;
+		if(can_map())
+			destination = map_buffer_range(
+				target, offset, size,
+				GL_MAP_WRITE_BIT_EXT |
+				GL_MAP_INVALIDATE_RANGE_BIT_EXT |
+				GL_MAP_UNSYNCHRONIZED_BIT_EXT);
+		if(destination) {
+			memcpy(destination, data, size);
+			unmap_buffer(target);
+		} else
+			glBufferSubData(target, offset, size, data);
+		head = offset + size;
+
+		return offset;
+	}
+
+};
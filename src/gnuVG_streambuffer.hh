@@ -0,0 +1,56 @@
+/*
+ * gnuVG - a free Vector Graphics library
+ * Copyright (C) 2016 by Anton Persson
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as
+ *  published by the Free Software Foundation, either version 3 of
+ *  the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+
+namespace gnuVG {
+
+	/* A streaming buffer object for transient geometry. Data is
+	 * appended once and referenced by its offset when drawing. When
+	 * the buffer is full the storage is orphaned, so the driver can
+	 * give us fresh memory instead of stalling on pending draws.
+	 * Every region is written once between orphans, so it is written
+	 * through an unsynchronized mapping when GL_EXT_map_buffer_range
+	 * is available.
+	 */
+	class StreamBuffer {
+	public:
+		StreamBuffer(GLenum target, GLsizeiptr initial_size);
+		~StreamBuffer();
+
+		// copy data into the buffer, returns the offset of the copy
+		GLintptr append(const void *data, GLsizeiptr size);
+		// make room for appends of this many bytes in total, so the
+		// arrays of one draw end up in the same storage
+		void reserve(GLsizeiptr size);
+
+		void bind();
+
+	private:
+		GLenum target;
+		GLuint buffer = 0;
+		GLsizeiptr capacity, head = 0;
+
+		void orphan(GLsizeiptr required_size);
+	};
+
+};